@@ -0,0 +1,320 @@
+/**
+ * @file SyntheticGoalSceneProvider.cpp
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+
+#include "SyntheticGoalSceneProvider.h"
+#include <algorithm>
+
+SyntheticGoalSceneProvider::SyntheticGoalSceneProvider() :
+  colorsPicked(false),
+  randomState(1)
+{
+}
+
+void SyntheticGoalSceneProvider::update(Image& image)
+{
+  MODIFY("module:SyntheticGoalSceneProvider:robotPose", robotPose);
+  MODIFY("module:SyntheticGoalSceneProvider:noise", noise);
+  MODIFY("module:SyntheticGoalSceneProvider:occlusion", occlusion);
+  MODIFY("module:SyntheticGoalSceneProvider:overexposure", overexposure);
+  MODIFY("module:SyntheticGoalSceneProvider:robots", robots);
+
+  if (!colorsPicked)
+    pickColors();
+
+  image.width = theCameraInfo.width;
+  image.height = theCameraInfo.height;
+  randomState = seed ? seed : 1;
+
+  //-- Ground: carpet, white marks on it and everything beyond the carpet
+  Vector2<> pointOnField;
+  for (int y=0; y<image.height; y++)
+    for (int x=0; x<image.width; x++)
+    {
+      Image::Pixel& pixel = image[y][x];
+      if (!Geometry::calculatePointOnField(x, y, theCameraMatrix, theCameraInfo, pointOnField))
+      {
+        pixel = background;
+        continue;
+      }
+
+      const Vector2<> p = robotPose * pointOnField;
+      if (std::abs(p.x) > theFieldDimensions.xPosOpponentFieldBorder || std::abs(p.y) > theFieldDimensions.yPosLeftFieldBorder)
+        pixel = background;
+      else
+        pixel = isOnWhiteGroundMark(p) ? white : green;
+    }
+
+  //-- Goals, the far one first. The robots are assumed to stand in front of the goals.
+  const Pose2D inverse = Pose2D(robotPose).invert();
+  const float goalX[2] = {theFieldDimensions.xPosOpponentGoalPost, theFieldDimensions.xPosOwnGoalPost};
+  const bool ownGoalFirst = robotPose.translation.x > 0;
+  for (int g=0; g<2; g++)
+  {
+    const float x = goalX[ownGoalFirst ? 1-g : g];
+    const Vector2<> leftPost = inverse * Vector2<>(x, theFieldDimensions.yPosLeftGoal);
+    const Vector2<> rightPost = inverse * Vector2<>(x, theFieldDimensions.yPosRightGoal);
+    paintCrossbar(image, leftPost, rightPost);
+
+    Box post;
+    post.width = theFieldDimensions.goalPostRadius * 2.f;
+    post.height = theFieldDimensions.goalHeight;
+    post.color = white;
+    post.position = leftPost.squareAbs() > rightPost.squareAbs() ? leftPost : rightPost;
+    paintBox(image, post, occlusion);
+    post.position = leftPost.squareAbs() > rightPost.squareAbs() ? rightPost : leftPost;
+    paintBox(image, post, occlusion);
+  }
+
+  //-- White robots, the far ones first
+  std::vector<Box> boxes;
+  for (const Vector2<>& r : robots)
+  {
+    Box robot;
+    robot.position = inverse * r;
+    robot.width = 300.f;
+    robot.height = 580.f;
+    robot.color = white;
+    boxes.push_back(robot);
+  }
+  std::sort(boxes.begin(), boxes.end(), [](const Box& a, const Box& b) { return a.position.squareAbs() > b.position.squareAbs(); });
+  for (const Box& box : boxes)
+    paintBox(image, box, 0.f);
+
+  //-- Overexposure (or a white robot right in front of the camera)
+  if (overexposure > 0.f)
+  {
+    const int marginX = (int)(image.width * (1.f - std::min(1.f, overexposure)) / 2.f);
+    const int marginY = (int)(image.height * (1.f - std::min(1.f, overexposure)) / 2.f);
+    for (int y=marginY; y<image.height-marginY; y++)
+      for (int x=marginX; x<image.width-marginX; x++)
+        image[y][x] = white;
+  }
+
+  //-- Noise
+  if (noise > 0)
+    for (int y=0; y<image.height; y++)
+      for (int x=0; x<image.width; x++)
+      {
+        Image::Pixel& pixel = image[y][x];
+        pixel.y = (unsigned char)std::max(0, std::min(255, pixel.y + (int)(random() % (2 * noise + 1)) - noise));
+        pixel.cb = (unsigned char)std::max(0, std::min(255, pixel.cb + (int)(random() % (2 * noise + 1)) - noise));
+        pixel.cr = (unsigned char)std::max(0, std::min(255, pixel.cr + (int)(random() % (2 * noise + 1)) - noise));
+        pixel.yCbCrPadding = pixel.y;
+      }
+}
+
+void SyntheticGoalSceneProvider::update(FieldBoundary& fieldBoundary)
+{
+  fieldBoundary.boundaryInImage.clear();
+  fieldBoundary.boundaryOnField.clear();
+  fieldBoundary.isValid = false;
+
+  //-- The boundary is the highest row of each column that shows the carpet
+  const int step = 8;
+  Vector2<> pointOnField;
+  for (int x=0; x<theCameraInfo.width; x+=step)
+  {
+    const int column = std::min(x, theCameraInfo.width-1);
+    for (int y=0; y<theCameraInfo.height; y++)
+    {
+      if (!Geometry::calculatePointOnField(column, y, theCameraMatrix, theCameraInfo, pointOnField))
+        continue;
+      const Vector2<> p = robotPose * pointOnField;
+      if (std::abs(p.x) > theFieldDimensions.xPosOpponentFieldBorder || std::abs(p.y) > theFieldDimensions.yPosLeftFieldBorder)
+        continue;
+
+      fieldBoundary.boundaryInImage.push_back(Vector2<int>(column, y));
+      fieldBoundary.boundaryOnField.push_back(pointOnField);
+      break;
+    }
+  }
+  fieldBoundary.isValid = fieldBoundary.boundaryInImage.size() > 1;
+}
+
+void SyntheticGoalSceneProvider::update(GroundTruthGoalPercept& groundTruthGoalPercept)
+{
+  groundTruthGoalPercept.goalPosts.clear();
+
+  const Pose2D inverse = Pose2D(robotPose).invert();
+  const float goalX[2] = {theFieldDimensions.xPosOpponentGoalPost, theFieldDimensions.xPosOwnGoalPost};
+  for (int g=0; g<2; g++)
+  {
+    std::vector<GoalPost> visible;
+    const float postY[2] = {theFieldDimensions.yPosLeftGoal, theFieldDimensions.yPosRightGoal};
+    for (int p=0; p<2; p++)
+    {
+      GoalPost post;
+      post.position = GoalPost::IS_UNKNOWN;
+      post.positionOnField = inverse * Vector2<>(goalX[g], postY[p]);
+
+      Vector2<int> top;
+      if (!Geometry::calculatePointInImage(Vector3<>(post.positionOnField.x, post.positionOnField.y, 0.f), theCameraMatrix, theCameraInfo, post.positionInImage) ||
+          !Geometry::calculatePointInImage(Vector3<>(post.positionOnField.x, post.positionOnField.y, theFieldDimensions.goalHeight), theCameraMatrix, theCameraInfo, top))
+        continue;
+      if (post.positionInImage.x < 0 || post.positionInImage.x >= theCameraInfo.width ||
+          post.positionInImage.y < 0 || top.y >= theCameraInfo.height)
+        continue;
+
+      visible.push_back(post);
+    }
+
+    if (visible.size() == 2)
+    {
+      const bool firstIsLeft = visible[0].positionInImage.x < visible[1].positionInImage.x;
+      visible[0].position = firstIsLeft ? GoalPost::IS_LEFT : GoalPost::IS_RIGHT;
+      visible[1].position = firstIsLeft ? GoalPost::IS_RIGHT : GoalPost::IS_LEFT;
+      groundTruthGoalPercept.timeWhenCompleteGoalLastSeen = theFrameInfo.time;
+    }
+    if (!visible.empty())
+      groundTruthGoalPercept.timeWhenGoalPostLastSeen = theFrameInfo.time;
+
+    groundTruthGoalPercept.goalPosts.insert(groundTruthGoalPercept.goalPosts.end(), visible.begin(), visible.end());
+  }
+}
+
+void SyntheticGoalSceneProvider::pickColors()
+{
+  white = pickColor(true);
+  green = pickColor(false);
+  background.y = background.yCbCrPadding = 40;
+  background.cb = 128;
+  background.cr = 128;
+  colorsPicked = true;
+}
+
+Image::Pixel SyntheticGoalSceneProvider::pickColor(bool isWhite)
+{
+  //-- Coarse search of the YCbCr cube for the colors accepted by the color reference
+  const int step = 8;
+  auto accepted = [&](int y, int cb, int cr) -> bool
+  {
+    Image::Pixel p;
+    p.y = p.yCbCrPadding = (unsigned char)y;
+    p.cb = (unsigned char)cb;
+    p.cr = (unsigned char)cr;
+    return isWhite ? theColorReference.isYellow(&p) : theColorReference.isGreen(&p);
+  };
+
+  Vector3<> sum;
+  int count = 0;
+  for (int y=step/2; y<256; y+=step)
+    for (int cb=step/2; cb<256; cb+=step)
+      for (int cr=step/2; cr<256; cr+=step)
+        if (accepted(y, cb, cr))
+        {
+          sum += Vector3<>((float)y, (float)cb, (float)cr);
+          count++;
+        }
+
+  Image::Pixel result;
+  if (!count)
+  {
+    OUTPUT_WARNING("SyntheticGoalSceneProvider: no " << (isWhite ? "white" : "green") << " in the color reference");
+    result.y = result.yCbCrPadding = isWhite ? 220 : 90;
+    result.cb = isWhite ? 128 : 110;
+    result.cr = isWhite ? 128 : 100;
+    return result;
+  }
+
+  //-- The center of an accepted range might not be accepted itself, so take the nearest accepted color
+  const Vector3<> center = sum / (float)count;
+  float bestDistance = 1e10f;
+  for (int y=step/2; y<256; y+=step)
+    for (int cb=step/2; cb<256; cb+=step)
+      for (int cr=step/2; cr<256; cr+=step)
+      {
+        const float distance = (Vector3<>((float)y, (float)cb, (float)cr) - center).squareAbs();
+        if (distance < bestDistance && accepted(y, cb, cr))
+        {
+          bestDistance = distance;
+          result.y = result.yCbCrPadding = (unsigned char)y;
+          result.cb = (unsigned char)cb;
+          result.cr = (unsigned char)cr;
+        }
+      }
+  return result;
+}
+
+bool SyntheticGoalSceneProvider::isOnWhiteGroundMark(const Vector2<>& p) const
+{
+  auto isOnSegment = [&](const Vector2<>& from, const Vector2<>& to, float halfWidth) -> bool
+  {
+    const Vector2<> dir = to - from;
+    const float t = std::max(0.f, std::min(1.f, ((p - from) * dir) / dir.squareAbs()));
+    return (from + dir * t - p).squareAbs() < halfWidth * halfWidth;
+  };
+
+  if (renderFieldLines)
+    for (const FieldDimensions::LinesTable::Line& line : theFieldDimensions.fieldLines.lines)
+      if (isOnSegment(line.corner.translation, line.corner * Vector2<>(line.length, 0), theFieldDimensions.fieldLinesWidth / 2.f))
+        return true;
+
+  //-- Goal frame on the ground behind both goals
+  for (float sign = -1.f; sign < 2.f; sign += 2.f)
+  {
+    const float front = sign * theFieldDimensions.xPosOpponentGoalPost;
+    const float back = sign * (theFieldDimensions.xPosOpponentGoalPost + theFieldDimensions.goalBaseLength);
+    const Vector2<> frontLeft(front, theFieldDimensions.yPosLeftGoal), frontRight(front, theFieldDimensions.yPosRightGoal);
+    const Vector2<> backLeft(back, theFieldDimensions.yPosLeftGoal), backRight(back, theFieldDimensions.yPosRightGoal);
+    if (isOnSegment(frontLeft, backLeft, theFieldDimensions.goalPostRadius) ||
+        isOnSegment(frontRight, backRight, theFieldDimensions.goalPostRadius) ||
+        isOnSegment(backLeft, backRight, theFieldDimensions.goalPostRadius))
+      return true;
+  }
+  return false;
+}
+
+void SyntheticGoalSceneProvider::paintBox(Image& image, const Box& box, float occluded)
+{
+  Vector2<int> base, top;
+  if (!Geometry::calculatePointInImage(Vector3<>(box.position.x, box.position.y, 0.f), theCameraMatrix, theCameraInfo, base) ||
+      !Geometry::calculatePointInImage(Vector3<>(box.position.x, box.position.y, box.height), theCameraMatrix, theCameraInfo, top) ||
+      base.y <= top.y)
+    return;
+
+  const float distance = (Vector3<>(box.position.x, box.position.y, box.height / 2.f) - theCameraMatrix.translation).abs();
+  const int halfWidth = std::max(1, (int)(Geometry::getSizeByDistance(theCameraInfo, box.width, distance) / 2.f));
+  const int occludedFrom = base.y - (int)((base.y - top.y) * occluded);
+
+  for (int y=std::max(0, top.y); y<=std::min(image.height-1, base.y); y++)
+  {
+    const int x = top.x + (base.x - top.x) * (y - top.y) / (base.y - top.y);
+    for (int px=std::max(0, x-halfWidth); px<=std::min(image.width-1, x+halfWidth); px++)
+      image[y][px] = y > occludedFrom ? background : box.color;
+  }
+}
+
+void SyntheticGoalSceneProvider::paintCrossbar(Image& image, const Vector2<>& leftPost, const Vector2<>& rightPost)
+{
+  const float upper = theFieldDimensions.goalHeight;
+  const float lower = theFieldDimensions.goalHeight - theFieldDimensions.goalPostRadius * 2.f;
+  Vector2<int> leftTop, leftBottom, rightTop, rightBottom;
+  if (!Geometry::calculatePointInImage(Vector3<>(leftPost.x, leftPost.y, upper), theCameraMatrix, theCameraInfo, leftTop) ||
+      !Geometry::calculatePointInImage(Vector3<>(leftPost.x, leftPost.y, lower), theCameraMatrix, theCameraInfo, leftBottom) ||
+      !Geometry::calculatePointInImage(Vector3<>(rightPost.x, rightPost.y, upper), theCameraMatrix, theCameraInfo, rightTop) ||
+      !Geometry::calculatePointInImage(Vector3<>(rightPost.x, rightPost.y, lower), theCameraMatrix, theCameraInfo, rightBottom) ||
+      leftTop.x == rightTop.x || leftBottom.x == rightBottom.x)
+    return;
+
+  const int from = std::max(0, std::min(leftTop.x, rightTop.x));
+  const int to = std::min(image.width-1, std::max(leftTop.x, rightTop.x));
+  for (int x=from; x<=to; x++)
+  {
+    const int yTop = leftTop.y + (rightTop.y - leftTop.y) * (x - leftTop.x) / (rightTop.x - leftTop.x);
+    const int yBottom = std::max(yTop, leftBottom.y + (rightBottom.y - leftBottom.y) * (x - leftBottom.x) / (rightBottom.x - leftBottom.x));
+    for (int y=std::max(0, yTop); y<=std::min(image.height-1, yBottom); y++)
+      image[y][x] = white;
+  }
+}
+
+unsigned SyntheticGoalSceneProvider::random()
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+MAKE_MODULE(SyntheticGoalSceneProvider, Infrastructure)
@@ -0,0 +1,123 @@
+/**
+ * @file SyntheticGoalSceneProvider.h
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+#pragma once
+
+#include "Tools/Math/Geometry.h"
+#include "Tools/Module/Module.h"
+#include "Representations/Perception/CameraMatrix.h"
+#include "Representations/Perception/FieldBoundary.h"
+#include "Representations/Perception/ColorReference.h"
+#include "Representations/Perception/GroundTruthGoalPercept.h"
+#include "Representations/Configuration/FieldDimensions.h"
+#include "Representations/Infrastructure/Image.h"
+#include "Representations/Infrastructure/CameraInfo.h"
+#include "Representations/Infrastructure/FrameInfo.h"
+#include "Tools/Debugging/DebugDrawings.h"
+
+MODULE(SyntheticGoalSceneProvider)
+  REQUIRES(CameraMatrix)
+  REQUIRES(CameraInfo)
+  REQUIRES(FieldDimensions)
+  REQUIRES(FrameInfo)
+  REQUIRES(ColorReference)
+  PROVIDES(Image)
+  PROVIDES(FieldBoundary)
+  PROVIDES_WITH_DRAW(GroundTruthGoalPercept)
+  LOADS_PARAMETER(Pose2D, robotPose) /// Pose of the robot on the field the scene is rendered from
+  LOADS_PARAMETER(std::vector<Vector2<> >, robots) /// Positions of white robots standing on the field
+  LOADS_PARAMETER(bool, renderFieldLines) /// Render the field lines (white clutter on the ground)
+  LOADS_PARAMETER(int, noise) /// Maximal deviation added to each channel of each pixel
+  LOADS_PARAMETER(float, occlusion) /// Part of each post (from its base) that is hidden behind a dark object
+  LOADS_PARAMETER(float, overexposure) /// Part of the image (centered) that is white, for worst case frames
+  LOADS_PARAMETER(unsigned, seed) /// Seed of the noise, same seed gives the same frames
+END_MODULE
+
+/**
+ * @class SyntheticGoalSceneProvider
+ * @brief Renders YCbCr images of the goals for deterministic GoalPerceptor benchmarks.
+ *
+ * The goal geometry is taken from the field dimensions, the colors are picked from
+ * whatever the color reference classifies as white ('yellow' in the CT) and green.
+ * The field boundary and the posts that should be perceived are provided together
+ * with the image.
+ */
+class SyntheticGoalSceneProvider: public SyntheticGoalSceneProviderBase
+{
+public:
+  /**
+   * @brief Default constructor for SyntheticGoalSceneProvider class
+   */
+  SyntheticGoalSceneProvider();
+
+private:
+  /**
+   * @class Box
+   * @brief A vertical object standing on the field (goal post or robot)
+   */
+  struct Box
+  {
+    Vector2<> position; /// Position relative to the robot
+    float width; /// Width in mm
+    float height; /// Height in mm
+    Image::Pixel color;
+  };
+
+  /**
+   * @brief Render the field, the goals and the clutter.
+   * @param image: Image to be rendered
+   */
+  void update(Image& image);
+
+  /**
+   * @brief Provide the field boundary of the rendered scene (the edge of the carpet).
+   * @param fieldBoundary: Pointer to the object to be update
+   */
+  void update(FieldBoundary& fieldBoundary);
+
+  /**
+   * @brief Provide the goal posts of the rendered scene that are inside the image.
+   * @param groundTruthGoalPercept: Pointer to the object to be update
+   */
+  void update(GroundTruthGoalPercept& groundTruthGoalPercept);
+
+  /**
+   * @brief Pick the colors of the scene from the color reference.
+   */
+  void pickColors();
+
+  /**
+   * @brief Find a color the given classification accepts, close to the center of all accepted ones.
+   * @param isWhite: Search for white ('yellow' in the CT) if true, green otherwise
+   */
+  Image::Pixel pickColor(bool isWhite);
+
+  /**
+   * @brief Check whether a point on the field is covered by a white line or by the goal frame
+   * @param p: Point in field coordinates
+   */
+  bool isOnWhiteGroundMark(const Vector2<>& p) const;
+
+  /**
+   * @brief Paint a box standing on the field into the image.
+   * @param occluded: Part of the box (from its base) to be painted with the background color
+   */
+  void paintBox(Image& image, const Box& box, float occluded);
+
+  /**
+   * @brief Paint the crossbar of a goal into the image.
+   */
+  void paintCrossbar(Image& image, const Vector2<>& leftPost, const Vector2<>& rightPost);
+
+  /**
+   * @brief Deterministic pseudo random number generator for the noise (xorshift)
+   */
+  unsigned random();
+
+  bool colorsPicked; /// The colors are picked from the color reference once
+  Image::Pixel white; /// Color of goal posts, robots and lines
+  Image::Pixel green; /// Color of the carpet
+  Image::Pixel background; /// Color of everything beyond the carpet and of the occluding objects
+  unsigned randomState; /// State of the noise generator
+};
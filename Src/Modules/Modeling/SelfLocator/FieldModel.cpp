@@ -9,9 +9,62 @@
 
 #include "FieldModel.h"
 #include "SelfLocatorParameters.h"
+#include "GoalPostVisibilityMap.h"
+#include "FieldModelProfile.h"
+#include "Platform/BHAssert.h"
+#include "Platform/Common/File.h"
 #include "Representations/Configuration/FieldDimensions.h"
 #include "Representations/Perception/CameraMatrix.h"
+#include "Tools/Debugging/DebugRequest.h"
 #include "Tools/Math/Geometry.h"
+#include <mutex>
+
+
+/**
+* The posts that can be seen from a place in a direction. All instances of the FieldModel
+* work on the same field, so they share the map. The simulator runs the cognition of several
+* robots in one process, so the map is initialized (and the cache file written) only once,
+* by the first FieldModel. It is never changed afterwards and read without a lock.
+*/
+static GoalPostVisibilityMap visibilityMap;
+static std::once_flag visibilityMapInitialized;
+
+static void initializeVisibilityMap(const Vector2<> goalPosts[GoalPostVisibilityMap::numOfPosts], const FieldDimensions& fieldDimensions,
+                                    const SelfLocatorParameters& parameters)
+{
+  std::call_once(visibilityMapInitialized, [&]
+  {
+    visibilityMap.initialize(goalPosts, fieldDimensions.goalPostRadius, parameters.goalAssociationMaxAngle,
+                             std::string(File::getBHDir()) + "/Config/goalPostVisibility.map");
+  });
+  ASSERT(visibilityMap.isInitializedFor(goalPosts, fieldDimensions.goalPostRadius, parameters.goalAssociationMaxAngle));
+}
+
+
+/** The measurements of the associations of this thread's robot. */
+static thread_local FieldModelProfile profile;
+
+/**
+* Measures an association from its construction to its destruction, if the debug request is active.
+*/
+class AssociationProbe
+{
+public:
+  AssociationProbe(FieldModelProfile::Association association) : association(association), active(false)
+  {
+    DEBUG_RESPONSE("module:SelfLocator:fieldModelCounters", active = profile.start(););
+  }
+
+  ~AssociationProbe()
+  {
+    if(active)
+      profile.stop(association);
+  }
+
+private:
+  FieldModelProfile::Association association;
+  bool active;
+};
 
 
 FieldModel::FieldModel(const FieldDimensions& fieldDimensions, const SelfLocatorParameters& parameters,
@@ -29,6 +82,7 @@ FieldModel::FieldModel(const FieldDimensions& fieldDimensions, const SelfLocator
   goalPosts[5] = Vector2<>(fieldDimensions.xPosOwnGoalPost - fieldDimensions.goalBaseLength,      fieldDimensions.yPosLeftGoal);
   goalPosts[6] = Vector2<>(fieldDimensions.xPosOpponentGoalPost + fieldDimensions.goalBaseLength, fieldDimensions.yPosLeftGoal);
   goalPosts[7] = Vector2<>(fieldDimensions.xPosOpponentGoalPost + fieldDimensions.goalBaseLength, fieldDimensions.yPosRightGoal);
+  initializeVisibilityMap(goalPosts, fieldDimensions, parameters);
 
   // Initialize list of relevant field lines
   for(unsigned int i = 0, count = fieldDimensions.fieldLines.lines.size(); i < count; ++i)
@@ -74,6 +128,7 @@ FieldModel::FieldModel(const FieldDimensions& fieldDimensions, const SelfLocator
 
 bool FieldModel::getAssociatedUnknownGoalPost(const Pose2D& robotPose, const Vector2<>& goalPercept, Vector2<>& associatedPost) const
 {
+  AssociationProbe probe(FieldModelProfile::goalPost);
   //-- NOTE: This part is the B-Human original code, and the problem is when
   //         confusing goal posts with the goal structure.
   //         So, a newer version has implemented to add goal structure to the
@@ -99,8 +154,16 @@ bool FieldModel::getAssociatedUnknownGoalPost(const Pose2D& robotPose, const Vec
   unsigned nearestId=0;
   float dist=9999999;
 
+  //-- Only the posts that can be seen in this direction from here are candidates, usually two or three.
+  //   Frame posts hidden behind a goal post are not among them, so they cannot be confused.
+  const unsigned char candidates = visibilityMap.getCandidates(robotPose.translation, (postInWorld - robotPose.translation).angle());
+  if (!candidates)
+    return false;
+
   for (unsigned i=0; i<8; ++i)
   {
+    if (!(candidates & (1 << i)))
+      continue;
     const float d = (postInWorld - goalPosts[i]).sqr();
     if (d < dist)
     {
@@ -116,6 +179,7 @@ bool FieldModel::getAssociatedUnknownGoalPost(const Pose2D& robotPose, const Vec
 
 bool FieldModel::getAssociatedKnownGoalPost(const Pose2D& robotPose, const Vector2<>& goalPercept, bool isLeft, Vector2<>& associatedPost) const
 {
+  AssociationProbe probe(FieldModelProfile::goalPost);
   const Vector2<> postInWorld = robotPose * goalPercept;
   if(postInWorld.x <= 0.f) // own half
   {
@@ -137,6 +201,7 @@ bool FieldModel::getAssociatedKnownGoalPost(const Pose2D& robotPose, const Vecto
 
 int FieldModel::getIndexOfAssociatedLine(const Pose2D& robotPose, const Vector2<>& start, const Vector2<>& end) const
 {
+  AssociationProbe probe(FieldModelProfile::line);
   Vector2<> startOnField = robotPose * start;
   Vector2<> endOnField = robotPose * end;
   Vector2<> dirOnField = endOnField - startOnField;
@@ -173,6 +238,7 @@ int FieldModel::getIndexOfAssociatedLine(const Pose2D& robotPose, const Vector2<
 
 bool FieldModel::getAssociatedCorner(const Pose2D& robotPose, const LinePercept::Intersection& intersection, Vector2<>& associatedCorner) const
 {
+  AssociationProbe probe(FieldModelProfile::corner);
   const std::vector< Vector2<> >* corners = &lCorners;
   if(intersection.type == LinePercept::Intersection::T)
     corners = &tCorners;
@@ -0,0 +1,108 @@
+/**
+* @file FieldModelProfile.h
+*
+* Declaration of the time and hardware counters of the associations of the FieldModel.
+*
+* @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+*/
+
+#pragma once
+
+#include "Modules/Perception/GoalPerfCounters.h"
+#include "Tools/Debugging/Debugging.h"
+#include <chrono>
+
+/**
+* The associations are called for every particle and percept, so they are summed up per kind
+* and their means per call are printed once a second. Every call is measured when the debug
+* request module:SelfLocator:fieldModelCounters is active. A measurement reads the counters
+* with a system call, so the means include its cost; they are good for comparing the kinds and
+* for comparing versions of the FieldModel, not as absolute numbers. If the counters are not
+* permitted, only the time is measured.
+* The simulator runs the cognition of several robots in one process, so there is a profile per thread.
+*/
+class FieldModelProfile
+{
+public:
+  enum Association
+  {
+    goalPost, /**< getAssociatedUnknownGoalPost and getAssociatedKnownGoalPost */
+    line, /**< getIndexOfAssociatedLine */
+    corner, /**< getAssociatedCorner */
+    numOfAssociations
+  };
+
+  FieldModelProfile() : countersRequested(false), lastReport(std::chrono::steady_clock::now()) { reset(); }
+
+  /** Start a measurement, returns false if the counters are requested but could not be read. */
+  bool start()
+  {
+    if(!countersRequested)
+    {
+      countersRequested = true;
+      if(!counters.open())
+        OUTPUT_WARNING("FieldModel: hardware counters are not permitted, measuring the time only");
+    }
+    if(counters.isOpen() && !counters.read(startCounts))
+      return false;
+    startTime = std::chrono::steady_clock::now();
+    return true;
+  }
+
+  /** Add the measurement since start() to an association, and print the means once a second. */
+  void stop(Association a)
+  {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    unsigned long long counts[GoalPerfCounters::numOfCounters];
+    if(counters.isOpen() && counters.read(counts))
+      for(int c = 0; c < GoalPerfCounters::numOfCounters; ++c)
+        sums[a][c] += counts[c] - startCounts[c];
+    nanoseconds[a] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - startTime).count();
+    ++calls[a];
+
+    if(now - lastReport >= std::chrono::seconds(1))
+    {
+      report();
+      reset();
+      lastReport = now;
+    }
+  }
+
+private:
+  void report() const
+  {
+    static const char* names[numOfAssociations] = {"goalPost", "line", "corner"};
+    for(int a = 0; a < numOfAssociations; ++a)
+    {
+      if(!calls[a])
+        continue;
+      const double n = (double)calls[a];
+      if(counters.isOpen())
+        OUTPUT_TEXT("FieldModel " << names[a] << ": " << calls[a] << " calls, " << nanoseconds[a] / n << " ns, "
+                    << sums[a][GoalPerfCounters::cycles] / n << " cycles, " << sums[a][GoalPerfCounters::instructions] / n << " instructions, "
+                    << sums[a][GoalPerfCounters::cacheMisses] / n << " cache misses, " << sums[a][GoalPerfCounters::branchMisses] / n << " branch misses per call");
+      else
+        OUTPUT_TEXT("FieldModel " << names[a] << ": " << calls[a] << " calls, " << nanoseconds[a] / n << " ns per call");
+    }
+  }
+
+  void reset()
+  {
+    for(int a = 0; a < numOfAssociations; ++a)
+    {
+      calls[a] = 0;
+      nanoseconds[a] = 0;
+      for(int c = 0; c < GoalPerfCounters::numOfCounters; ++c)
+        sums[a][c] = 0;
+    }
+  }
+
+  GoalPerfCounters counters; /**< Counters of this thread */
+  bool countersRequested; /**< Whether opening the counters was tried */
+  unsigned long long startCounts[GoalPerfCounters::numOfCounters]; /**< Counter values at start() */
+  std::chrono::steady_clock::time_point startTime; /**< Time of start() */
+  std::chrono::steady_clock::time_point lastReport; /**< Time of the last report */
+  unsigned calls[numOfAssociations]; /**< Calls since the last report */
+  long long nanoseconds[numOfAssociations]; /**< Time since the last report */
+  unsigned long long sums[numOfAssociations][GoalPerfCounters::numOfCounters]; /**< Counts since the last report */
+};
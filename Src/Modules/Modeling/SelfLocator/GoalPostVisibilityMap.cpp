@@ -0,0 +1,165 @@
+/**
+* @file GoalPostVisibilityMap.cpp
+*
+* Implementation of a map that tells which goal posts can be seen in a direction from a place on the field
+*
+* @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a>
+*/
+
+#include "GoalPostVisibilityMap.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+const float GoalPostVisibilityMap::cellSize = 250.f;
+const float GoalPostVisibilityMap::sectorSize = pi2 / GoalPostVisibilityMap::numOfSectors;
+const float GoalPostVisibilityMap::xMin = -GoalPostVisibilityMap::numOfXCells * GoalPostVisibilityMap::cellSize / 2.f;
+const float GoalPostVisibilityMap::yMin = -GoalPostVisibilityMap::numOfYCells * GoalPostVisibilityMap::cellSize / 2.f;
+
+static const unsigned cacheMagic = 0x4d565047; // "GPVM"
+static const unsigned cacheVersion = 2;
+static const int samplesPerEdge = 5; // Samples of each edge of a cell for the occlusion, 50 mm apart
+
+
+void GoalPostVisibilityMap::initialize(const Vector2<> posts[numOfPosts], float postRadius, float maxAngle, const std::string& path)
+{
+  for(unsigned i = 0; i < numOfPosts; ++i)
+    this->posts[i] = posts[i];
+  this->postRadius = postRadius;
+  this->maxAngle = maxAngle;
+
+  if(load(path))
+    return;
+  compute();
+  save(path);
+}
+
+
+bool GoalPostVisibilityMap::isInitializedFor(const Vector2<> posts[numOfPosts], float postRadius, float maxAngle) const
+{
+  if(cells.empty() || postRadius != this->postRadius || maxAngle != this->maxAngle)
+    return false;
+  for(unsigned i = 0; i < numOfPosts; ++i)
+    if(posts[i] != this->posts[i])
+      return false;
+  return true;
+}
+
+
+void GoalPostVisibilityMap::compute()
+{
+  cells.assign(numOfXCells * numOfYCells * numOfSectors, 0);
+  const float h = cellSize / 2.f;
+
+  for(int y = 0; y < numOfYCells; ++y)
+    for(int x = 0; x < numOfXCells; ++x)
+    {
+      const Vector2<> center(xMin + (x + 0.5f) * cellSize, yMin + (y + 0.5f) * cellSize);
+
+      // The center and the boundary of the cell. A gap between two posts that is only open
+      // between two samples of the boundary is missed, and the post behind it counts as hidden.
+      std::vector< Vector2<> > points(1, center);
+      for(int k = 0; k < samplesPerEdge; ++k)
+      {
+        const float t = -h + cellSize * k / samplesPerEdge;
+        points.push_back(center + Vector2<>(t, -h));
+        points.push_back(center + Vector2<>(h, t));
+        points.push_back(center + Vector2<>(-t, h));
+        points.push_back(center + Vector2<>(-h, -t));
+      }
+      unsigned char* sectors = &cells[(y * numOfXCells + x) * numOfSectors];
+
+      for(unsigned i = 0; i < numOfPosts; ++i)
+      {
+        // A post is hidden if a nearer post covers it from everywhere in the cell
+        bool hidden = true;
+        for(const Vector2<>& p : points)
+        {
+          const float distance = (posts[i] - p).abs();
+          bool covered = false;
+          for(unsigned j = 0; j < numOfPosts && !covered; ++j)
+          {
+            const float otherDistance = (posts[j] - p).abs();
+            if(j == i || otherDistance >= distance)
+              continue;
+            const float separation = std::abs(normalize((posts[j] - p).angle() - (posts[i] - p).angle()));
+            covered = separation < std::atan2(postRadius, otherDistance) - std::atan2(postRadius, distance);
+          }
+          hidden &= covered;
+        }
+        if(hidden)
+          continue;
+
+        // The range of directions to the post over the cell
+        const bool inside = std::abs(posts[i].x - center.x) <= h && std::abs(posts[i].y - center.y) <= h;
+        const float centerDirection = (posts[i] - center).angle();
+        float low = 0.f, high = 0.f;
+        for(const Vector2<>& p : points)
+        {
+          const float a = normalize((posts[i] - p).angle() - centerDirection);
+          low = std::min(low, a);
+          high = std::max(high, a);
+        }
+        const float direction = centerDirection + (low + high) / 2.f;
+        const float range = (high - low) / 2.f + sectorSize / 2.f + maxAngle;
+
+        for(int s = 0; s < numOfSectors; ++s)
+          if(inside || std::abs(normalize(-pi + (s + 0.5f) * sectorSize - direction)) <= range)
+            sectors[s] |= 1 << i;
+      }
+    }
+}
+
+
+bool GoalPostVisibilityMap::load(const std::string& path)
+{
+  std::ifstream stream(path.c_str(), std::ios::binary);
+  if(!stream)
+    return false;
+
+  unsigned header[5];
+  Vector2<> cachedPosts[numOfPosts];
+  float cachedRadius, cachedAngle;
+  stream.read(reinterpret_cast<char*>(header), sizeof(header));
+  stream.read(reinterpret_cast<char*>(cachedPosts), sizeof(cachedPosts));
+  stream.read(reinterpret_cast<char*>(&cachedRadius), sizeof(cachedRadius));
+  stream.read(reinterpret_cast<char*>(&cachedAngle), sizeof(cachedAngle));
+  if(!stream || header[0] != cacheMagic || header[1] != cacheVersion || header[2] != (unsigned)numOfXCells ||
+     header[3] != (unsigned)numOfYCells || header[4] != (unsigned)numOfSectors ||
+     cachedRadius != postRadius || cachedAngle != maxAngle)
+    return false;
+  for(unsigned i = 0; i < numOfPosts; ++i)
+    if(cachedPosts[i] != posts[i])
+      return false;
+
+  cells.resize(numOfXCells * numOfYCells * numOfSectors);
+  stream.read(reinterpret_cast<char*>(&cells[0]), cells.size());
+  if(!stream)
+  {
+    cells.clear();
+    return false;
+  }
+  return true;
+}
+
+
+void GoalPostVisibilityMap::save(const std::string& path) const
+{
+  // The cache is an optimization only, a failure to write it is not an error. It is written
+  // to another file first, so a reader never sees a half written cache.
+  const std::string temporary = path + ".tmp";
+  std::ofstream stream(temporary.c_str(), std::ios::binary);
+  if(!stream)
+    return;
+  const unsigned header[5] = {cacheMagic, cacheVersion, (unsigned)numOfXCells, (unsigned)numOfYCells, (unsigned)numOfSectors};
+  stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+  stream.write(reinterpret_cast<const char*>(posts), sizeof(posts));
+  stream.write(reinterpret_cast<const char*>(&postRadius), sizeof(postRadius));
+  stream.write(reinterpret_cast<const char*>(&maxAngle), sizeof(maxAngle));
+  stream.write(reinterpret_cast<const char*>(&cells[0]), cells.size());
+  stream.close();
+  if(stream)
+    std::rename(temporary.c_str(), path.c_str());
+  else
+    std::remove(temporary.c_str());
+}
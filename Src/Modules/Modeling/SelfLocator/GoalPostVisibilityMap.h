@@ -0,0 +1,80 @@
+/**
+* @file GoalPostVisibilityMap.h
+*
+* Declaration of a map that tells which goal posts (and posts of the goal frames) can be
+* seen in a direction from a place on the field. It is computed once and cached on disk.
+* The occlusion is sampled at the center of a cell and every 50 mm along its boundary.
+*
+* @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a>
+*/
+
+#pragma once
+
+#include "Tools/Math/Common.h"
+#include "Tools/Math/Vector2.h"
+#include <string>
+#include <vector>
+
+class GoalPostVisibilityMap
+{
+public:
+  static const unsigned numOfPosts = 8; /**< The goal posts and the frame posts, in the order of FieldModel */
+  static const unsigned char allPosts = 0xff; /**< The candidates outside of the map */
+
+  GoalPostVisibilityMap() : postRadius(0.f), maxAngle(0.f) {}
+
+  /**
+  * Load the map from the cache file if it was computed for the same posts, otherwise compute and store it.
+  * Not thread-safe, the map must not be read while it is initialized.
+  * @param posts The posts in the order of FieldModel
+  * @param postRadius The radius of a post, for the occlusion
+  * @param maxAngle The maximal angle between a seen post and its model (goalAssociationMaxAngle)
+  * @param path The cache file
+  */
+  void initialize(const Vector2<> posts[numOfPosts], float postRadius, float maxAngle, const std::string& path);
+
+  /**
+  * Checks whether the map was initialized for the given posts and angle.
+  */
+  bool isInitializedFor(const Vector2<> posts[numOfPosts], float postRadius, float maxAngle) const;
+
+  /**
+  * The posts that can be seen from a position on the field in a direction.
+  * @param position The position of the robot on the field
+  * @param direction The direction of the line of sight in field coordinates
+  * @return A bit per post (bit i for post i), allPosts outside of the map
+  */
+  unsigned char getCandidates(const Vector2<>& position, float direction) const
+  {
+    const int x = (int)((position.x - xMin) / cellSize);
+    const int y = (int)((position.y - yMin) / cellSize);
+    if(position.x < xMin || position.y < yMin || x >= numOfXCells || y >= numOfYCells || cells.empty())
+      return allPosts;
+    int sector = (int)((direction + pi) / sectorSize);
+    sector = sector < 0 ? 0 : (sector >= numOfSectors ? numOfSectors - 1 : sector);
+    return cells[(y * numOfXCells + x) * numOfSectors + sector];
+  }
+
+private:
+  static const int numOfXCells = 44; /**< Cells along the field, covering the goal frames */
+  static const int numOfYCells = 32; /**< Cells across the field, covering the border strip */
+  static const int numOfSectors = 16; /**< Directions of the line of sight */
+  static const float cellSize; /**< Edge length of a cell in mm */
+  static const float sectorSize; /**< Angle of a sector */
+  static const float xMin; /**< Field x of the first cell */
+  static const float yMin; /**< Field y of the first cell */
+
+  /** Compute the map from the posts. */
+  void compute();
+
+  /** Read the cache file, false if it does not exist or was computed for something else. */
+  bool load(const std::string& path);
+
+  /** Write the cache file. */
+  void save(const std::string& path) const;
+
+  Vector2<> posts[numOfPosts];
+  float postRadius;
+  float maxAngle;
+  std::vector<unsigned char> cells; /**< Candidate bits per cell and sector */
+};
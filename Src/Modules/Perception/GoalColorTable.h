@@ -0,0 +1,193 @@
+/**
+ * @file GoalColorTable.h
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+#pragma once
+
+#include "Representations/Perception/ColorReference.h"
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @class GoalColorStatistics
+ * @brief Counts of the colors of confirmed goal post pixels and of the green below their bases.
+ */
+class GoalColorStatistics
+{
+public:
+  GoalColorStatistics() : post(numOfCells, 0), green(numOfCells, 0) {}
+
+  void addPost(const Image::Pixel& p) { add(post, p); }
+  void addGreen(const Image::Pixel& p) { add(green, p); }
+
+  /**
+   * @brief Halve all counts, so the statistics follow a change of the light.
+   */
+  void decay()
+  {
+    for(int i = 0; i < numOfCells; ++i)
+    {
+      post[i] >>= 1;
+      green[i] >>= 1;
+    }
+  }
+
+  /**
+   * @brief The cell of a color, 32 steps per channel
+   */
+  static int cell(unsigned char y, unsigned char cb, unsigned char cr) { return (y >> 3) << 10 | (cb >> 3) << 5 | cr >> 3; }
+
+  static const int numOfCells = 32 * 32 * 32;
+  std::vector<unsigned short> post; /// Count of confirmed post pixels per cell
+  std::vector<unsigned short> green; /// Count of pixels below confirmed bases per cell
+
+private:
+  static void add(std::vector<unsigned short>& counts, const Image::Pixel& p)
+  {
+    unsigned short& count = counts[cell(p.y, p.cb, p.cr)];
+    if(count < 0xffff)
+      ++count;
+  }
+};
+
+/**
+ * @class GoalColorTable
+ * @brief Immutable classification of white ('yellow' in the CT) of every color (2 MB).
+ *
+ * A table is complete when it is constructed and never changes afterwards, so it can
+ * be handed from the builder thread to the cognition thread without locking. Without
+ * statistics it classifies every color exactly as the color reference does. The
+ * statistics overrule it in cells of 8 steps per channel, like they are counted.
+ */
+class GoalColorTable
+{
+public:
+  /**
+   * @brief Sample the color reference and overrule it where the statistics are clear.
+   * @param minHits: Minimal count of a cell of the statistics to overrule the color reference
+   */
+  GoalColorTable(const ColorReference& reference, const GoalColorStatistics& statistics, unsigned minHits)
+  {
+    Image::Pixel p;
+    for(int y = 0; y < 256; ++y)
+      for(int cb = 0; cb < 256; ++cb)
+        for(int cr = 0; cr < 256; ++cr)
+        {
+          p.y = (unsigned char)y;
+          p.cb = (unsigned char)cb;
+          p.cr = (unsigned char)cr;
+          const int c = GoalColorStatistics::cell(p.y, p.cb, p.cr);
+          const unsigned post = statistics.post[c], green = statistics.green[c];
+
+          bool white = reference.isYellow(&p);
+          if(post >= minHits && post > 4 * green)
+            white = true;
+          else if(green >= minHits && green > 4 * post)
+            white = false;
+          table[index(p.y, p.cb, p.cr)] = white;
+        }
+  }
+
+  inline bool isWhite(unsigned char y, unsigned char cb, unsigned char cr) const { return table[index(y, cb, cr)]; }
+
+private:
+  static inline int index(unsigned char y, unsigned char cb, unsigned char cr) { return y << 16 | cb << 8 | cr; }
+
+  std::bitset<256 * 256 * 256> table;
+};
+
+/**
+ * @class GoalColorTableBuilder
+ * @brief Builds color tables on a low priority thread and publishes them by an atomic pointer swap.
+ *
+ * The cognition thread requests a table without waiting (the request is dropped if the
+ * builder is busy taking the previous one) and takes a finished table at the beginning
+ * of a frame. A finished table that was not taken yet is replaced by a newer one.
+ */
+class GoalColorTableBuilder
+{
+public:
+  GoalColorTableBuilder() : minHits(0), requested(false), stopping(false), pending(nullptr), thread(&GoalColorTableBuilder::work, this) {}
+
+  ~GoalColorTableBuilder()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wakeUp.notify_one();
+    thread.join();
+    delete pending.exchange(nullptr);
+  }
+
+  /**
+   * @brief Request a new table, never blocks.
+   * @return False if the request could not be placed, it should be repeated later
+   */
+  bool request(const ColorReference& reference, const GoalColorStatistics& statistics, unsigned minHits)
+  {
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if(!lock.owns_lock() || requested)
+      return false;
+    this->reference = reference;
+    this->statistics = statistics;
+    this->minHits = minHits;
+    requested = true;
+    lock.unlock();
+    wakeUp.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Take the latest finished table, if there is one. The caller owns it.
+   */
+  GoalColorTable* take() { return pending.exchange(nullptr, std::memory_order_acquire); }
+
+private:
+  void work()
+  {
+#ifdef LINUX
+    //-- The table is not urgent, the cognition thread must not lose time to it
+    sched_param param;
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for(;;)
+    {
+      wakeUp.wait(lock, [this] { return stopping || requested; });
+      if(stopping)
+        return;
+      const ColorReference reference = this->reference;
+      GoalColorStatistics statistics;
+      std::swap(statistics, this->statistics);
+      const unsigned minHits = this->minHits;
+      requested = false;
+      lock.unlock();
+
+      GoalColorTable* table = new GoalColorTable(reference, statistics, minHits);
+      delete pending.exchange(table, std::memory_order_acq_rel);
+
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex; /// Guards the request
+  std::condition_variable wakeUp; /// A table was requested or the builder is stopped
+  ColorReference reference; /// Snapshot of the color reference of the request
+  GoalColorStatistics statistics; /// Snapshot of the statistics of the request
+  unsigned minHits; /// Parameter of the request
+  bool requested; /// There is a request that was not taken yet
+  bool stopping; /// The thread has to return
+  std::atomic<GoalColorTable*> pending; /// Finished table that was not taken yet
+  std::thread thread; /// Must be the last member, it starts working when it is constructed
+};
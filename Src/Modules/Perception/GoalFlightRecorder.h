@@ -0,0 +1,185 @@
+/**
+ * @file GoalFlightRecorder.h
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+#pragma once
+
+#include "GoalPerfCounters.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @class GoalFlightRecorder
+ * @brief Fixed-size ring buffer of compact per-frame statistics of the GoalPerceptor.
+ *
+ * The cognition thread is the only writer. A record is published by advancing the
+ * frame counter, so a reader always sees complete records. The buffer is dumped to
+ * a binary file that the GoalFlightReport tool turns into timelines and histograms.
+ * If the hardware counters are enabled, each stage also gets its share of them. The
+ * counters only count the cognition thread, the strips that the workers scan are missing
+ * from the scanning stage.
+ */
+class GoalFlightRecorder
+{
+public:
+  enum Stage
+  {
+    scanning, /// scanFieldBoundarySpots (twice in a partner search) and the vertical scans
+    rejecting, /// robot, duplicate, body contour and vote point rejections
+    positioning, /// calculatePosition
+    validating, /// validate
+    posting, /// posting
+    numOfStages
+  };
+
+  enum Flags
+  {
+    noCameraMatrix = 1, /// The frame was dropped for an invalid camera matrix
+    predicted = 2, /// The upper camera was skipped, its posts are in the PredictedGoalPercept
+    scanLimitHit = 4, /// A scan was cut by the bounded mode
+    reused = 8, /// The scan was skipped for a static scene, its percept is empty
+    fixedResolution = 16, /// The scans compiled for the image's resolution were used
+    partnerSearch = 32 /// The field boundary was scanned a second time, for the partner of a post
+  };
+
+  /**
+   * @class Record
+   * @brief Statistics of one frame (28 bytes)
+   */
+  struct Record
+  {
+    unsigned time; /// Frame time
+    unsigned char camera; /// CameraInfo::Camera
+    unsigned char flags; /// Combination of Flags
+    unsigned char spotsFound; /// Candidates after scanFieldBoundarySpots, of both scans of a partner search
+    unsigned char spotsVoted; /// Candidates after the vote point check, of both scans of a partner search
+    unsigned char spotsValidated; /// Candidates above the quality after validate
+    unsigned char spotsRemaining; /// Candidates after all rejections
+    unsigned char validities[2]; /// Validity of the two best candidates, 0 if there are none
+    unsigned short durations[numOfStages]; /// Microseconds per stage
+    unsigned short padding[3];
+  };
+
+  /**
+   * @class Counters
+   * @brief Hardware counters of one frame, per stage (80 bytes)
+   */
+  struct Counters
+  {
+    unsigned values[numOfStages][GoalPerfCounters::numOfCounters];
+  };
+
+  static const unsigned numOfRecords = 32768; /// About nine minutes of both cameras at 30 Hz each
+  static const unsigned magic = 0x52465047; /// "GPFR"
+  static const unsigned version = 3;
+
+  GoalFlightRecorder() : records(numOfRecords), frames(0)
+  {
+    std::fill(lastCounts, lastCounts + GoalPerfCounters::numOfCounters, 0ull);
+  }
+
+  /**
+   * @brief Start counting cycles, instructions, cache and branch misses per stage.
+   * @return False if the counters are not permitted, then only the time is recorded
+   */
+  bool enableCounters()
+  {
+    if(!perfCounters.open())
+      return false;
+    if(counters.empty())
+      counters.resize(numOfRecords);
+    return true;
+  }
+
+  /**
+   * @brief Start the record of a new frame.
+   */
+  void begin(unsigned time, unsigned char camera)
+  {
+    Record& r = current();
+    r = Record();
+    r.time = time;
+    r.camera = camera;
+    if(!counters.empty())
+    {
+      currentCounters() = Counters();
+      if(!perfCounters.read(lastCounts))
+        std::fill(lastCounts, lastCounts + GoalPerfCounters::numOfCounters, 0ull);
+    }
+    lastMark = std::chrono::steady_clock::now();
+  }
+
+  /**
+   * @brief Add the time and the counts since the last mark (or the beginning) to the given stage.
+   *
+   * The counters are only read if they are enabled. Then every mark costs a system call,
+   * which is counted in the stage of the next mark.
+   */
+  void stage(Stage s)
+  {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const long long us = std::chrono::duration_cast<std::chrono::microseconds>(now - lastMark).count();
+    const long long sum = current().durations[s] + us;
+    current().durations[s] = (unsigned short)(sum < 0xffff ? sum : 0xffff);
+    lastMark = now;
+
+    unsigned long long counts[GoalPerfCounters::numOfCounters];
+    if(!counters.empty() && perfCounters.read(counts))
+      for(int c = 0; c < GoalPerfCounters::numOfCounters; ++c)
+      {
+        const unsigned long long total = currentCounters().values[s][c] + (counts[c] - lastCounts[c]);
+        currentCounters().values[s][c] = (unsigned)(total < 0xffffffffull ? total : 0xffffffffull);
+        lastCounts[c] = counts[c];
+      }
+  }
+
+  /**
+   * @brief The record of the current frame, to fill in counts and flags.
+   */
+  Record& current() { return records[frames.load(std::memory_order_relaxed) % numOfRecords]; }
+
+  /**
+   * @brief Publish the record of the current frame.
+   */
+  void commit() { frames.fetch_add(1, std::memory_order_release); }
+
+  /**
+   * @brief Write the recorded frames in chronological order to a binary file.
+   * @return False if the file could not be written
+   */
+  bool dump(const std::string& path) const
+  {
+    const unsigned count = frames.load(std::memory_order_acquire);
+    const unsigned stored = count < numOfRecords ? count : numOfRecords;
+    std::ofstream stream(path.c_str(), std::ios::binary);
+    if(!stream)
+      return false;
+
+    const unsigned header[4] = {magic, version, (unsigned)sizeof(Record), stored};
+    stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+    for(unsigned i = count - stored; i < count; ++i)
+      stream.write(reinterpret_cast<const char*>(&records[i % numOfRecords]), sizeof(Record));
+
+    //-- The counters of the same frames follow, if they were recorded
+    const unsigned counterHeader[2] = {counters.empty() ? 0u : 1u, (unsigned)sizeof(Counters)};
+    stream.write(reinterpret_cast<const char*>(counterHeader), sizeof(counterHeader));
+    if(!counters.empty())
+      for(unsigned i = count - stored; i < count; ++i)
+        stream.write(reinterpret_cast<const char*>(&counters[i % numOfRecords]), sizeof(Counters));
+    return stream.good();
+  }
+
+private:
+  Counters& currentCounters() { return counters[frames.load(std::memory_order_relaxed) % numOfRecords]; }
+
+  std::vector<Record> records; /// numOfRecords records (about 900 KB), on the heap instead of inside the module
+  std::vector<Counters> counters; /// Empty unless the counters are enabled
+  GoalPerfCounters perfCounters; /// Counters of the cognition thread
+  unsigned long long lastCounts[GoalPerfCounters::numOfCounters]; /// Counter values at the last stage mark
+  std::atomic<unsigned> frames; /// Number of committed frames
+  std::chrono::steady_clock::time_point lastMark; /// Time of the last stage mark
+};
@@ -0,0 +1,183 @@
+/**
+ * @file GoalImageView.h
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+#pragma once
+
+#include "Representations/Infrastructure/Image.h"
+#include <algorithm>
+#include <vector>
+
+/**
+ * Pixel access for the scans of the GoalPerceptor. The scans are templates on one of
+ * these views, so the pixel addressing is inlined for the layout in use.
+ */
+namespace GoalImageView
+{
+  /**
+   * @class YUYV
+   * @brief The packed 4:2:2 buffer of the camera, addressed directly by its byte stride.
+   *
+   * Each pixel of the perceptor is one Y0 Cb Y1 Cr quadruple of the camera, of which
+   * Y1 is used as luminance. This is the view for any resolution, FixedYUYV is the one
+   * for the resolutions the scans are compiled for.
+   *
+   * Image::Pixel is this quadruple (yCbCrPadding, cb, y, cr), and logged images store
+   * the same bytes, so images from the camera and from logs both use this view. There
+   * is no other layout that would need a second one.
+   */
+  class YUYV
+  {
+  public:
+    YUYV(const Image& image) :
+      width(image.width), height(image.height),
+      data(reinterpret_cast<const unsigned char*>(image[0])),
+      stride((int)(reinterpret_cast<const unsigned char*>(image[1]) - reinterpret_cast<const unsigned char*>(image[0])))
+    {}
+
+    inline const Image::Pixel* pixel(int x, int y) const { return reinterpret_cast<const Image::Pixel*>(data + y * stride + (x << 2)); }
+    inline unsigned char luma(int x, int y) const { return data[y * stride + (x << 2) + 2]; }
+    inline unsigned char cb(int x, int y) const { return data[y * stride + (x << 2) + 1]; }
+    inline unsigned char cr(int x, int y) const { return data[y * stride + (x << 2) + 3]; }
+    inline int rowStride() const { return stride; }
+
+    const int width;
+    const int height;
+
+  private:
+    const unsigned char* data; /// First byte of the first row
+    const int stride; /// Bytes from one row to the next
+  };
+
+  /**
+   * @class FixedYUYV
+   * @brief The packed buffer of the camera, with dimensions and row stride known at compile time.
+   *
+   * The scans instantiated on this view have constant loop bounds and pixel offsets.
+   * It must only be constructed for an image that has exactly these dimensions and
+   * this stride (see GoalPerceptor::processFixedResolution).
+   */
+  template<int Width, int Height, int Stride> class FixedYUYV
+  {
+  public:
+    FixedYUYV(const Image& image) : data(reinterpret_cast<const unsigned char*>(image[0])) {}
+
+    inline const Image::Pixel* pixel(int x, int y) const { return reinterpret_cast<const Image::Pixel*>(data + y * Stride + (x << 2)); }
+    inline unsigned char luma(int x, int y) const { return data[y * Stride + (x << 2) + 2]; }
+    inline unsigned char cb(int x, int y) const { return data[y * Stride + (x << 2) + 1]; }
+    inline unsigned char cr(int x, int y) const { return data[y * Stride + (x << 2) + 3]; }
+
+    static const int width = Width;
+    static const int height = Height;
+
+  private:
+    const unsigned char* data; /// First byte of the first row
+  };
+
+  template<int Width, int Height, int Stride> const int FixedYUYV<Width, Height, Stride>::width;
+  template<int Width, int Height, int Stride> const int FixedYUYV<Width, Height, Stride>::height;
+
+  /**
+   * @class ClassificationMemo
+   * @brief Memo of the white classification, for bands of columns around the spots.
+   *
+   * The traces visit many pixels more than once (the re-centering walks, the scans down
+   * and up, the crossbar), a memoized pixel is not classified again. The first visit
+   * still reads the pixel from the rows of the image. The memo bytes of a column are
+   * adjacent, so the memo of a vertical trace stays in few cache lines.
+   *
+   * A byte holds the number of the frame it was classified in and the result in its
+   * lowest bit. A byte of an older frame is unknown, so the memo is not cleared per frame.
+   */
+  class ClassificationMemo
+  {
+  public:
+    ClassificationMemo() : height(0), numOfSlots(0), frame(0) {}
+
+    /**
+     * @brief Forget the bands of the last frame.
+     */
+    void reset(int width, int height)
+    {
+      slots.assign(width, -1);
+      this->height = height;
+      numOfSlots = 0;
+    }
+
+    /**
+     * @brief Memoize the columns from first to last (clipped to the image), until maxColumns are in the memo.
+     */
+    void addBand(int first, int last, int maxColumns)
+    {
+      first = first < 0 ? 0 : first;
+      last = last >= (int)slots.size() ? (int)slots.size() - 1 : last;
+      for(int x = first; x <= last && numOfSlots < maxColumns; ++x)
+        if(slots[x] < 0)
+          slots[x] = numOfSlots++;
+    }
+
+    /**
+     * @brief Start a frame on the bands that were added, all pixels unknown.
+     */
+    void commit()
+    {
+      //-- Only when the frame numbers wrap around, the old bytes have to be cleared
+      if (++frame > maxFrame)
+      {
+        std::fill(data.begin(), data.end(), (unsigned char)0);
+        frame = 1;
+      }
+      if (data.size() < (size_t)(numOfSlots * height))
+        data.resize(numOfSlots * height, 0);
+    }
+
+    /**
+     * @brief The byte of a pixel, or nullptr if its column is not in the memo.
+     */
+    inline unsigned char* at(int x, int y) { return slots[x] < 0 ? nullptr : &data[slots[x] * height + y]; }
+
+    /**
+     * @brief Whether the byte was classified in this frame.
+     */
+    inline bool isKnown(unsigned char c) const { return (unsigned)(c >> 1) == frame; }
+
+    /**
+     * @brief The byte of a pixel classified in this frame.
+     */
+    inline unsigned char classified(bool white) const { return (unsigned char)(frame << 1 | (white ? 1 : 0)); }
+
+    /**
+     * @brief Whether a known byte is white.
+     */
+    static inline bool isWhite(unsigned char c) { return (c & 1) != 0; }
+
+  private:
+    enum { maxFrame = 127 }; /// The frame number takes the upper 7 bits of a byte
+
+    std::vector<int> slots; /// Per image column, its slot in data or -1
+    std::vector<unsigned char> data; /// numOfSlots columns of height bytes, may be longer from earlier frames
+    int height;
+    int numOfSlots;
+    unsigned frame; /// Number of the current frame, 1 to maxFrame
+  };
+
+  /**
+   * @class Memoized
+   * @brief Any of the views above, with its white classification memoized in a ClassificationMemo.
+   */
+  template<typename View> class Memoized
+  {
+  public:
+    Memoized(const View& view, ClassificationMemo& memo) : width(view.width), height(view.height), view(view), memo(memo) {}
+
+    inline const Image::Pixel* pixel(int x, int y) const { return view.pixel(x, y); }
+    inline unsigned char luma(int x, int y) const { return view.luma(x, y); }
+    inline unsigned char cb(int x, int y) const { return view.cb(x, y); }
+    inline unsigned char cr(int x, int y) const { return view.cr(x, y); }
+
+    const int width;
+    const int height;
+    const View& view;
+    ClassificationMemo& memo;
+  };
+}
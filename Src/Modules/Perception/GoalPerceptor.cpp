@@ -8,13 +8,23 @@
 #include "GoalPerceptor.h"
 #include "Platform/Common/File.h"
 #include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
 #include <iostream>
 #include <fstream>
 #include <string.h>
 
 GoalPerceptor::GoalPerceptor() :
 	candidateSpot(0 , 0 , 0 ) ,
-	RobotRejection(false)
+	RobotRejection(false),
+	scanLimitHit(false),
+	perfCountersRequested(false),
+	stripWorkers(std::max(1, scanThreads)),
+	timeWhenColorTableRequested(0),
+	timeWhenCompleteGoalMeasured(0),
+	timeOfCurrentFrame(0),
+	goalScanSkipped(false)
 {
 }
 
@@ -35,53 +45,505 @@ void GoalPerceptor::update(GoalPercept& percept)
 	MODIFY("module:GoalPerceptor:minVotePoint", minVotePoint);
 	MODIFY("module:GoalPerceptor:quality", quality);
 	MODIFY("module:GoalPerceptor:colorDifference", colorDifferenceValue);
+	MODIFY("module:GoalPerceptor:adaptiveScheduling", adaptiveScheduling);
+	MODIFY("module:GoalPerceptor:boundedScans", boundedScans);
+	MODIFY("module:GoalPerceptor:colorTable", colorTable);
+	MODIFY("module:GoalPerceptor:classificationMemo", classificationMemo);
+	MODIFY("module:GoalPerceptor:coarseSearch", coarseSearch);
+	MODIFY("module:GoalPerceptor:pairedSearch", pairedSearch);
+	MODIFY("module:GoalPerceptor:perfCounters", perfCounters);
+	MODIFY("module:GoalPerceptor:fixedResolutions", fixedResolutions);
+
+	DEBUG_RESPONSE_ONCE("module:GoalPerceptor:dumpFlightRecorder", dumpFlightRecorder(); );
+
+	//-- The counters are opened by the thread they count, once
+	if(perfCounters && !perfCountersRequested)
+	{
+		perfCountersRequested = true;
+		if(!flightRecorder.enableCounters())
+			OUTPUT_WARNING("GoalPerceptor: hardware counters are not permitted, recording the time only");
+	}
 
 	//-- clear old data
 	percept.goalPosts.clear();
 	spots.clear();
+	scanLimitHit = false;
+	beginFrame();
+	flightRecorder.begin(theFrameInfo.time, (unsigned char)theCameraInfo.camera);
+	GoalFlightRecorder::Record& record = flightRecorder.current();
 
 	if(!theCameraMatrix.isValid)
+	{
+		record.flags |= GoalFlightRecorder::noCameraMatrix;
+		flightRecorder.commit();
+		return;
+	}
+
+	if(goalScanSkipped)
+	{
+		drawPredictedGoal();
+		record.flags |= GoalFlightRecorder::predicted;
+		flightRecorder.commit();
+		return;
+	}
+
+	if(staticSceneShortCut && isSceneStatic())
+	{
+		drawStaticScene();
+		record.flags |= GoalFlightRecorder::reused;
+		flightRecorder.commit();
 		return;
+	}
 
 	//-- Scan height is equaling with horizon clipped by image boundaries.
 	int scanHeight = std::max(1, (int)theImageCoordinateSystem.origin.y);
 	scanHeight = std::min(scanHeight, theImage.height-2);
 	LINE("module:GoalPerceptor:Spots", 1, scanHeight, theImage.width-1, scanHeight, 1, Drawings::ps_dash, ColorClasses::orange);
 
-	//-- Find the possible goal-posts
-	scanFieldBoundarySpots(scanHeight);
+	rasterizeBodyContour();
+	maskRobotColumns();
+	updateColorTable();
+	postMemory.forget(theFrameInfo.time, postMemoryDuration);
+	postMemory.project(theCameraMatrix, theCameraInfo);
 
-	//-- Process possibilities
-	verticalColorScanDown();
-	verticalColorScanUp();
-	clipSpotBoundaries();
+	//-- Find the possible goal-posts and process them
+	if(fixedResolutions && processFixedResolution(scanHeight))
+		record.flags |= GoalFlightRecorder::fixedResolution;
+	else
+		processSpots(GoalImageView::YUYV(theImage), scanHeight);
 
-	//-- Validation checks
-	if (RobotRejection)
-	  rejectRobot();
-	calculateVotePoints(); //-- This function just remove the spots with low vote point percentage
-	// bottomCorrector(); //-- Commented in RC2015
-	calculatePosition(scanHeight);
+	//-- Validation checks between the spots, the spots are positioned and scored on their own already
 	validate();
-	removeNotGoalposts();
+	record.spotsRemaining = (unsigned char)std::min<size_t>(spots.size(), 255);
+	record.spotsValidated = (unsigned char)std::min<size_t>(std::count_if(spots.begin(), spots.end(), [&](const Spot& s) { return s.validity > quality; }), 255);
+	flightRecorder.stage(GoalFlightRecorder::validating);
 
 	//-- Export the results
+	std::list<Spot>::const_reverse_iterator best = spots.rbegin();
+	for(int v = 0; v < 2 && best != spots.rend(); ++v, ++best)
+		record.validities[v] = (unsigned char)std::max(0.f, std::min(best->validity, 255.f));
+	if(colorTable)
+		collectColorStatistics();
 	posting(percept);
+	if(staticSceneShortCut)
+		storeStaticScene(percept);
+	flightRecorder.stage(GoalFlightRecorder::posting);
+	if(scanLimitHit)
+		record.flags |= GoalFlightRecorder::scanLimitHit;
+	flightRecorder.commit();
+
+	PLOT("module:GoalPerceptor:scanLimitHit", scanLimitHit ? 1 : 0);
+	if(scanLimitHit)
+		DRAWTEXT("module:GoalPerceptor:Scans", 5, 5, 10, ColorClasses::red, "scan limit hit");
 }
 
-void GoalPerceptor::clipSpotBoundaries()
+GoalPerceptor::~GoalPerceptor()
 {
-  for (Spot& s : spots)
+  //-- Keep the statistics of the game when the process is stopped
+  if (flightRecorderDump)
+    dumpFlightRecorder();
+}
+
+void GoalPerceptor::dumpFlightRecorder()
+{
+  const std::string path = std::string(File::getBHDir()) + "/Config/goalFlightRecorder.log";
+  if (!flightRecorder.dump(path))
+    OUTPUT_WARNING("GoalPerceptor: could not write " << path);
+}
+
+bool GoalPerceptor::processFixedResolution(const int& height)
+{
+  //-- The framework may skip every second row of the camera, that doubles the stride
+  const GoalImageView::YUYV image(theImage);
+  const int packed = image.width * (int)sizeof(Image::Pixel);
+  if (image.width == 320 && image.height == 240)
+  {
+    if (image.rowStride() == packed)
+      processSpots(GoalImageView::FixedYUYV<320, 240, 320 * 4>(theImage), height);
+    else if (image.rowStride() == 2 * packed)
+      processSpots(GoalImageView::FixedYUYV<320, 240, 640 * 4>(theImage), height);
+    else
+      return false;
+    return true;
+  }
+  if (image.width == 640 && image.height == 480)
   {
-    RECTANGLE("module:GoalPerceptor:ShapeScans", s.top.x, s.top.y, s.base.x, s.base.y, 4, Drawings::ps_solid, ColorClasses::red);
+    if (image.rowStride() == packed)
+      processSpots(GoalImageView::FixedYUYV<640, 480, 640 * 4>(theImage), height);
+    else if (image.rowStride() == 2 * packed)
+      processSpots(GoalImageView::FixedYUYV<640, 480, 1280 * 4>(theImage), height);
+    else
+      return false;
+    return true;
+  }
+  return false;
+}
 
-    if (s.base.x < s.start)
-      s.base.x = s.start;
-    if (s.top.x > s.end)
-      s.top.x = s.end;
+template<typename View>
+void GoalPerceptor::processSpots(const View& image, const int& height)
+{
+  //-- The paired search needs the runs of white coarse samples even without the coarse search
+  markCandidateWindows(image, image.width / 2, coarseSearch || pairedSearch);
+  if (pairedSearch && searchGoalPair(image, height))
+    return;
+  if (!coarseSearch)
+    candidateWindows.assign(image.width / 2, true);
+  scanSpots(image, height);
+}
 
-    RECTANGLE("module:GoalPerceptor:ShapeScans", s.top.x, s.top.y, s.base.x, s.base.y, 2, Drawings::ps_dot, ColorClasses::yellow);
+template<typename View>
+bool GoalPerceptor::searchGoalPair(const View& image, const int& height)
+{
+  //-- The widest run of candidate columns is scanned first
+  const std::vector<bool> windows = candidateWindows;
+  int bestFirst = -1, bestLength = 0;
+  for (int c = 0, first = -1; c <= (int)windows.size(); c++)
+  {
+    if (c < (int)windows.size() && windows[c])
+    {
+      if (first < 0)
+        first = c;
+      continue;
+    }
+    if (first >= 0 && c - first > bestLength)
+    {
+      bestFirst = first;
+      bestLength = c - first;
+    }
+    first = -1;
   }
+  if (bestFirst < 0)
+    return false;
+
+  std::fill(candidateWindows.begin(), candidateWindows.end(), false);
+  std::fill(candidateWindows.begin() + bestFirst, candidateWindows.begin() + bestFirst + bestLength, true);
+  scanSpots(image, height);
+  validate();
+  flightRecorder.stage(GoalFlightRecorder::validating);
+
+  //-- The rest of the image is only scanned where the partner of a strong post can be
+  std::list<Spot> found;
+  found.splice(found.end(), spots);
+  const std::list<Spot>::iterator strongest = found.empty() ? found.end() : std::prev(found.end());
+  const bool strong = strongest != found.end() && strongest->validity >= pairedSearchValidity;
+  const bool complete = found.size() > 1 && std::prev(strongest)->validity > quality;
+  if (complete)
+  {
+    spots.splice(spots.end(), found);
+    return true;
+  }
+
+  if (coarseSearch)
+    candidateWindows = windows;
+  else
+    candidateWindows.assign(windows.size(), true);
+  std::fill(candidateWindows.begin() + bestFirst, candidateWindows.begin() + bestFirst + bestLength, false);
+  if (strong)
+    maskPartnerWindows(*strongest);
+  flightRecorder.current().flags |= GoalFlightRecorder::partnerSearch;
+  scanSpots(image, height);
+
+  //-- Only a spot that is the partner by itself gets a side, a side found by the crossbar scan is kept
+  if (strong)
+  {
+    const float goalWidth = std::abs(theFieldDimensions.yPosLeftGoal) * 2.f;
+    for (Spot& s : spots)
+    {
+      const float deviation = std::abs((s.position - strongest->position).abs() - goalWidth) / goalWidth;
+      const bool partner = (int)(100 - deviation * 50) > 75; //-- The distance check of validate
+      if (!s.plausible || !partner || (s.ownScore + 75 + quality) / 5.f <= quality)
+        continue;
+      if (s.leftRight == GoalPost::IS_UNKNOWN)
+        s.leftRight = s.mid.x > strongest->mid.x ? GoalPost::IS_RIGHT : GoalPost::IS_LEFT;
+      if (strongest->leftRight == GoalPost::IS_UNKNOWN)
+        strongest->leftRight = s.mid.x > strongest->mid.x ? GoalPost::IS_LEFT : GoalPost::IS_RIGHT;
+    }
+  }
+  spots.splice(spots.end(), found);
+  return true;
+}
+
+void GoalPerceptor::maskPartnerWindows(const Spot& post)
+{
+  //-- The partner is a goal width away from the post. The goal is seen at an unknown angle, so the
+  //   arc of the positions up to maxGoalSkew from facing the goal squarely is projected to the image.
+  const float goalWidth = std::abs(theFieldDimensions.yPosLeftGoal) * 2.f;
+  Vector2<> across(-post.position.y, post.position.x);
+  if (across.abs() < 1.f)
+    return;
+  across.normalize(goalWidth);
+
+  std::vector<bool> partner(candidateWindows.size(), false);
+  const int margin = std::max(4, post.width * 2);
+  for (int side = -1; side <= 1; side += 2)
+  {
+    //-- The robot's left is the image's left, a left post has its partner to the right
+    if ((side > 0 && post.leftRight == GoalPost::IS_LEFT) || (side < 0 && post.leftRight == GoalPost::IS_RIGHT))
+      continue;
+
+    int left = theImage.width, right = -1;
+    const int steps = 8;
+    for (int i = -steps; i <= steps; i++)
+    {
+      Vector2<int> inImage;
+      Vector2<> direction = across * (float)side;
+      direction.rotate(maxGoalSkew * i / steps);
+      if (!Geometry::calculatePointInImage(post.position + direction, theCameraMatrix, theCameraInfo, inImage))
+        continue;
+      left = std::min(left, inImage.x);
+      right = std::max(right, inImage.x);
+    }
+    for (int x = std::max(0, left - margin); x <= std::min(theImage.width-1, right + margin); x++)
+      partner[x/2] = true;
+    RECTANGLE("module:GoalPerceptor:Candidates", left, 0, right, theImage.height-1, 1, Drawings::ps_dash, ColorClasses::yellow);
+  }
+
+  for (size_t c = 0; c < candidateWindows.size(); c++)
+    candidateWindows[c] = candidateWindows[c] && partner[c];
+}
+
+template<typename View>
+void GoalPerceptor::scanSpots(const View& image, const int& height)
+{
+  GoalFlightRecorder::Record& record = flightRecorder.current();
+
+  //-- Candidates, and the checks that only need their position
+  scanFieldBoundarySpots(image, height);
+  record.spotsFound = (unsigned char)std::min<size_t>(record.spotsFound + spots.size(), 255); //-- Both scans of a paired search
+  flightRecorder.stage(GoalFlightRecorder::scanning);
+  if (RobotRejection)
+    rejectRobot();
+  flightRecorder.stage(GoalFlightRecorder::rejecting);
+
+  //-- The vertical traces stay in the columns around the candidates
+  if (classificationMemo)
+  {
+    memoizeSpotColumns();
+    traceSpots(GoalImageView::Memoized<View>(image, spotMemo), height);
+  }
+  else
+    traceSpots(image, height);
+}
+
+template<typename View>
+void GoalPerceptor::traceSpots(const View& image, const int& height)
+{
+  GoalFlightRecorder::Record& record = flightRecorder.current();
+
+  //-- Each spot is taken through all of its own steps while its columns are still in the CPU cache,
+  //   a rejected spot is dropped before anything else is done for it.
+  size_t voted = 0;
+  for (std::list<Spot>::iterator i = spots.begin(); i != spots.end();)
+  {
+    Spot& spot = *i;
+    verticalColorScanDown(image, spot);
+    flightRecorder.stage(GoalFlightRecorder::scanning);
+    if (isBaseHidden(spot) || hasLowVotePoint(spot))
+    {
+      i = spots.erase(i);
+      flightRecorder.stage(GoalFlightRecorder::rejecting);
+      continue;
+    }
+    if (baseRefinement)
+      refineBase(image, spot);
+    voted++;
+    flightRecorder.stage(GoalFlightRecorder::rejecting);
+
+    verticalColorScanUp(image, spot);
+    clipSpotBoundaries(spot);
+    flightRecorder.stage(GoalFlightRecorder::scanning);
+    calculatePosition(spot, height);
+    flightRecorder.stage(GoalFlightRecorder::positioning);
+    scoreSpot(spot);
+    flightRecorder.stage(GoalFlightRecorder::validating);
+    i++;
+  }
+  record.spotsVoted = (unsigned char)std::min<size_t>(record.spotsVoted + voted, 255);
+
+  //-- The crossbar is the only part of the shape that needs all spots
+  scanCrossbar(image);
+  flightRecorder.stage(GoalFlightRecorder::scanning);
+}
+
+void GoalPerceptor::update(PredictedGoalPercept& predictedGoalPercept)
+{
+  predictedGoalPercept.goalPosts.clear();
+  beginFrame();
+  if (!goalScanSkipped)
+    return;
+
+  Pose2D inverseOdometry = odometrySinceCompleteGoal;
+  inverseOdometry.invert();
+  for (const GoalPost& post : completeGoal)
+  {
+    GoalPost predicted = post;
+    const Vector2<> positionOnField = inverseOdometry * post.positionOnField;
+    if (!Geometry::calculatePointInImage(positionOnField, theCameraMatrix, theCameraInfo, predicted.positionInImage))
+      continue;
+    predicted.positionOnField = positionOnField;
+    predictedGoalPercept.goalPosts.push_back(predicted);
+  }
+  predictedGoalPercept.timeWhenGoalPostLastSeen = timeWhenCompleteGoalMeasured;
+  predictedGoalPercept.timeWhenCompleteGoalLastSeen = timeWhenCompleteGoalMeasured;
+}
+
+void GoalPerceptor::beginFrame()
+{
+  if (theFrameInfo.time == timeOfCurrentFrame)
+    return;
+  timeOfCurrentFrame = theFrameInfo.time;
+
+  odometrySinceCompleteGoal += theOdometer.odometryOffset;
+  for (StaticScene& scene : staticScenes)
+    scene.odometry += theOdometer.odometryOffset;
+  postMemory.move(theOdometer.odometryOffset);
+  goalScanSkipped = theCameraMatrix.isValid && !goalPerceptionRequired();
+}
+
+bool GoalPerceptor::goalPerceptionRequired()
+{
+  if (!adaptiveScheduling || theCameraInfo.camera != CameraInfo::upper || completeGoal.empty())
+    return true;
+
+  const Vector2<> headAngles(theFilteredJointData.angles[JointData::HeadYaw], theFilteredJointData.angles[JointData::HeadPitch]);
+  return theFrameInfo.getTimeSince(timeWhenCompleteGoalMeasured) > maxPredictionAge ||
+         odometrySinceCompleteGoal.translation.abs() > maxPredictionTranslation ||
+         std::abs(odometrySinceCompleteGoal.rotation) > maxPredictionRotation ||
+         (headAngles - headAnglesOfCompleteGoal).abs() > maxPredictionHeadMotion;
+}
+
+void GoalPerceptor::drawPredictedGoal()
+{
+  COMPLEX_DRAWING("module:GoalPerceptor:Spots",
+  {
+    Pose2D inverseOdometry = odometrySinceCompleteGoal;
+    inverseOdometry.invert();
+    for (const GoalPost& post : completeGoal)
+    {
+      Vector2<int> inImage;
+      if (Geometry::calculatePointInImage(inverseOdometry * post.positionOnField, theCameraMatrix, theCameraInfo, inImage))
+        CROSS("module:GoalPerceptor:Spots", inImage.x, inImage.y, 5, 2, Drawings::ps_dash, ColorClasses::yellow);
+    }
+  });
+}
+
+void GoalPerceptor::sampleBoundary()
+{
+  boundarySamples.clear();
+  if (theFieldBoundary.boundaryInImage.empty())
+    return;
+
+  //-- A post that appears or moves crosses the boundary, the row above it covers the post itself
+  for (int x=0; x<theImage.width; x+=16)
+  {
+    const int y = boundaryStepGenerator(x);
+    for (int row = y-8; row <= y; row += 8)
+      boundarySamples.push_back(row >= 0 && row < theImage.height ? theImage[row][x].y : 0);
+  }
+}
+
+bool GoalPerceptor::isSceneStatic()
+{
+  sampleBoundary();
+  const StaticScene& scene = staticScenes[theCameraInfo.camera];
+  if (!scene.valid || scene.reused >= maxStaticFrames || boundarySamples.empty() || boundarySamples.size() != scene.samples.size())
+    return false;
+
+  if (scene.odometry.translation.abs() > maxStaticTranslation || std::abs(scene.odometry.rotation) > maxStaticRotation)
+    return false;
+
+  //-- For small rotations, the axes of the camera move by about the angle
+  const float cameraRotation = std::max((theCameraMatrix.rotation.c[0] - scene.cameraMatrix.rotation.c[0]).abs(),
+                                        (theCameraMatrix.rotation.c[2] - scene.cameraMatrix.rotation.c[2]).abs());
+  if (cameraRotation > maxStaticCameraRotation || (theCameraMatrix.translation - scene.cameraMatrix.translation).abs() > maxStaticCameraTranslation)
+    return false;
+
+  //-- A strict hash would never match under the noise of the camera, so the samples are compared with a tolerance
+  int difference = 0;
+  for (size_t i=0; i<boundarySamples.size(); i++)
+    difference += std::abs(boundarySamples[i] - scene.samples[i]);
+  return difference <= maxStaticPixelDifference * (int)boundarySamples.size();
+}
+
+void GoalPerceptor::drawStaticScene()
+{
+  StaticScene& scene = staticScenes[theCameraInfo.camera];
+  scene.reused++;
+
+  for (const GoalPost& post : scene.posts)
+    CROSS("module:GoalPerceptor:Spots", post.positionInImage.x, post.positionInImage.y, 5, 2, Drawings::ps_solid, ColorClasses::yellow);
+}
+
+void GoalPerceptor::storeStaticScene(const GoalPercept& percept)
+{
+  //-- The samples were taken by isSceneStatic in this frame
+  StaticScene& scene = staticScenes[theCameraInfo.camera];
+  scene.valid = true;
+  scene.reused = 0;
+  scene.posts = percept.goalPosts;
+  scene.cameraMatrix = theCameraMatrix;
+  scene.odometry = Pose2D();
+  scene.samples = boundarySamples;
+}
+
+int GoalPerceptor::iterationLimit() const
+{
+  return boundedScans ? std::max(1, maxScanIterations) : std::numeric_limits<int>::max();
+}
+
+int GoalPerceptor::pixelBudget() const
+{
+  return boundedScans ? scanPixelBudget : std::numeric_limits<int>::max();
+}
+
+void GoalPerceptor::reportScanLimit(const Spot& spot)
+{
+  scanLimitHit = true;
+  CROSS("module:GoalPerceptor:Scans", spot.mid.x, spot.mid.y, 6, 2, Drawings::ps_solid, ColorClasses::red);
+}
+
+void GoalPerceptor::clipSpotBoundaries(Spot& spot)
+{
+  RECTANGLE("module:GoalPerceptor:ShapeScans", spot.top.x, spot.top.y, spot.base.x, spot.base.y, 4, Drawings::ps_solid, ColorClasses::red);
+
+  if (spot.base.x < spot.start)
+    spot.base.x = spot.start;
+  if (spot.top.x > spot.end)
+    spot.top.x = spot.end;
+
+  RECTANGLE("module:GoalPerceptor:ShapeScans", spot.top.x, spot.top.y, spot.base.x, spot.base.y, 2, Drawings::ps_dot, ColorClasses::yellow);
+}
+
+int GoalPerceptor::postTopLimit(const Vector2<int>& base)
+{
+  //-- Image distortion is not corrected here, the margin covers it
+  Vector2<> baseOnField;
+  if (!Geometry::calculatePointOnField(base.x, base.y, theCameraMatrix, theCameraInfo, baseOnField))
+    return 0;
+
+  Vector2<int> topInImage;
+  if (!Geometry::calculatePointInImage(Vector3<>(baseOnField.x, baseOnField.y, theFieldDimensions.goalHeight), theCameraMatrix, theCameraInfo, topInImage))
+    return 0;
+
+  const int margin = (int)((base.y - topInImage.y) * scanWindowMargin) + 2;
+  return topInImage.y - margin;
+}
+
+int GoalPerceptor::postBaseLimit(const Spot& spot)
+{
+  //-- The width of the post bounds how near its base can be. The spot's width is sampled every second
+  //   column and the post may be partly occluded, so it is trusted for no more than half of the post.
+  const float maxWidth = (spot.width + 4.f) * 2.f * (1.f + scanWindowMargin);
+  const float minDistance = Geometry::getDistanceBySize(theCameraInfo, theFieldDimensions.goalPostRadius * 2.f, maxWidth);
+
+  Vector2<> angle;
+  Geometry::calculateAnglesForPoint(Vector2<>(spot.mid), theCameraMatrix, theCameraInfo, angle);
+  Vector2<int> baseInImage;
+  if (!Geometry::calculatePointInImage(Vector2<>(std::cos(angle.x), std::sin(angle.x)) * minDistance, theCameraMatrix, theCameraInfo, baseInImage))
+    return theImage.height-1;
+
+  const int margin = (int)((baseInImage.y - spot.mid.y) * scanWindowMargin) + 2;
+  return std::max(spot.mid.y + 1, std::min(theImage.height-1, baseInImage.y + margin));
 }
 
 int GoalPerceptor::boundaryStepGenerator(int x)
@@ -117,60 +579,46 @@ int GoalPerceptor::boundaryStepGenerator(int x)
 	return -1;
 }
 
-void GoalPerceptor::scanFieldBoundarySpots(const int& height)
+template<typename View>
+void GoalPerceptor::scanFieldBoundarySpots(const View& image, const int& height)
 {
-	unsigned char Y=0, Cr=0, Cb=0;
+	//-- boundaryStepGenerator throws without a boundary, which must happen here and not in a worker
+	boundaryStepGenerator(0);
+
+	//-- The columns are independent, so they are scanned in strips, possibly in parallel
+	const int numOfColumns = image.width / 2;
+	boundaryColumns.resize(numOfColumns);
+	const unsigned numOfStrips = image.width >= minParallelScanWidth ? stripWorkers.numOfThreads() : 1;
+	stripWorkers.run(numOfStrips, [&](unsigned strip)
+	{
+		scanBoundaryColumns(image, height, numOfColumns * strip / numOfStrips, numOfColumns * (strip + 1) / numOfStrips);
+	});
 
+	//-- The columns are joined into spots in order, so spots crossing the seams of the strips
+	//   are the same as in a single pass over the image
+	const int minCandidateHeight = 30;
 	int noGapX = 2;
-	for (int x=0; x<theImage.width-1; x+=2)
+	for (int x=0; x<image.width-1; x+=2)
 	{
-		int y=boundaryStepGenerator(x);
-		if (y>-1 && y<theImage.height && isWhite(x, y))
+		const BoundaryColumn& column = boundaryColumns[x/2];
+		if (column.white)
 		{
 			noGapX++;
-			Y = theImage[y][x].y;
-			Cb = theImage[y][x].cb;
-			Cr = theImage[y][x].cr;
-
-			int start, end, noGap=2;
-			for (start=y; start>1; start-=2)
-				if (isInGrad(x, start, Y, Cr, Cb))
-					noGap++;
-				else if (noGap>1)
-					noGap=0;
-				else
-				{
-					start+=2;
-					break;
-				}
-
-			noGap=2;
-			for (end=y; end<theImage.height-1; end+=2)
-				if (isInGrad(x, end, Y, Cr, Cb))
-					noGap++;
-				else if (noGap>1)
-					noGap=0;
-				else
-				{
-					end-=2;
-					break;
-				}
-
-			if (end - start < 30)
+			if (column.end - column.start < minCandidateHeight)
 				continue;
 
 			if (candidateSpot.width == 0)
 			{
 				candidateSpot.start = x;
-				candidateSpot.mid = Vector2<int>(x, y);
-				candidateSpot.top = Vector2<int>(candidateSpot.mid.x, start);
-				candidateSpot.base = Vector2<int>(candidateSpot.mid.x, end);
+				candidateSpot.mid = Vector2<int>(x, column.y);
+				candidateSpot.top = Vector2<int>(candidateSpot.mid.x, column.start);
+				candidateSpot.base = Vector2<int>(candidateSpot.mid.x, column.end);
 			}
 
-			if (candidateSpot.top.y > start)
-				candidateSpot.top = Vector2<int>(candidateSpot.mid.x, start);
-			if (candidateSpot.base.y < end)
-				candidateSpot.base = Vector2<int>(candidateSpot.mid.x, end);
+			if (candidateSpot.top.y > column.start)
+				candidateSpot.top = Vector2<int>(candidateSpot.mid.x, column.start);
+			if (candidateSpot.base.y < column.end)
+				candidateSpot.base = Vector2<int>(candidateSpot.mid.x, column.end);
 
 			candidateSpot.end = x+1;
 			candidateSpot.width = candidateSpot.end - candidateSpot.start;
@@ -182,7 +630,6 @@ void GoalPerceptor::scanFieldBoundarySpots(const int& height)
 		else if (candidateSpot.width < 3)
 		{
 			candidateSpot = Spot(0, 0, 0);
-			Y=Cr=Cb=0;
 		}
 		else
 		{
@@ -193,13 +640,94 @@ void GoalPerceptor::scanFieldBoundarySpots(const int& height)
 				spots.push_back(candidateSpot);
 
 			candidateSpot = Spot(0, 0, 0);
-			Y=Cr=Cb=0;
 		}
 	}
 }
 
+template<typename View>
+void GoalPerceptor::markCandidateWindows(const View& image, int numOfColumns, bool coarse)
+{
+  if (!coarse)
+  {
+    candidateWindows.assign(numOfColumns, true);
+    return;
+  }
 
-void GoalPerceptor::findSpots(const int& height)
+  //-- The step is not wider than the farthest post (as in scoreSpot), so every post is hit at least once
+  candidateWindows.assign(numOfColumns, false);
+  const float maxDistance = (Vector2<>(theFieldDimensions.xPosOpponentFieldBorder, theFieldDimensions.yPosLeftFieldBorder) - Vector2<>(theFieldDimensions.xPosOwnFieldBorder, theFieldDimensions.yPosRightFieldBorder)).abs() * 1.3f;
+  const int narrowestPost = (int)Geometry::getSizeByDistance(theCameraInfo, theFieldDimensions.goalPostRadius * 2.f, maxDistance);
+  const int step = std::max(2, std::min(coarseStep, narrowestPost));
+  for (int x=0; x<image.width-1; x+=step)
+  {
+    const int y = boundaryStepGenerator(x);
+    if (y>-1 && y<image.height && isWhite(image, x, y))
+      for (int c = std::max(0, (x-step)/2); c <= std::min(numOfColumns-1, (x+step)/2); c++)
+        candidateWindows[c] = true;
+  }
+}
+
+template<typename View>
+void GoalPerceptor::scanBoundaryColumns(const View& image, const int& height, int first, int last)
+{
+  const int minCandidateHeight = 30;
+  for (int c = first; c < last; ++c)
+  {
+    BoundaryColumn& column = boundaryColumns[c];
+    const int x = c * 2;
+    if (!candidateWindows[c])
+    {
+      column.white = false;
+      continue;
+    }
+    const int y = boundaryStepGenerator(x);
+    column.white = y>-1 && y<image.height && isWhite(image, x, y);
+    if (!column.white)
+      continue;
+
+    unsigned char Y = image.luma(x, y);
+    unsigned char Cb = image.cb(x, y);
+    unsigned char Cr = image.cr(x, y);
+
+    //-- The post has to reach the horizon, and it is not taller than a post based on the boundary
+    const int topLimit = std::max(1, std::min(postTopLimit(Vector2<int>(x, y)), height));
+
+    int start, end, noGap=2;
+    for (start=y; start>topLimit; start-=2)
+      if (isInGrad(image, x, start, Y, Cr, Cb))
+        noGap++;
+      else if (noGap>1)
+        noGap=0;
+      else
+      {
+        start+=2;
+        break;
+      }
+
+    //-- The real base is found by verticalColorScanDown, so this walk only has to prove the minimal height
+    const int endLimit = std::min(std::min(image.height-1, bodyContourTop[x]), start + minCandidateHeight);
+
+    noGap=2;
+    for (end=y; end<endLimit; end+=2)
+      if (isInGrad(image, x, end, Y, Cr, Cb))
+        noGap++;
+      else if (noGap>1)
+        noGap=0;
+      else
+      {
+        end-=2;
+        break;
+      }
+
+    column.y = y;
+    column.start = start;
+    column.end = end;
+  }
+}
+
+
+template<typename View>
+void GoalPerceptor::findSpots(const View& image, const int& height)
 {
   // [XXX] : unused function
   ASSERT(false);
@@ -207,16 +735,16 @@ void GoalPerceptor::findSpots(const int& height)
 	int sum;
 	int skipped;
 
-	for(int i = 0; i < theImage.width; i++)
+	for(int i = 0; i < image.width; i++)
 	{
-		if(isWhite(i, height))
+		if(isWhite(image, i, height))
 		{
 			start = i;
 			sum = 0;
 			skipped = 0;
-			while (i < theImage.width && skipped < yellowSkipping)
+			while (i < image.width && skipped < yellowSkipping)
 			{
-				if (isWhite(i, height))
+				if (isWhite(image, i, height))
 				{
 					sum++;
 					skipped = 0;
@@ -238,275 +766,364 @@ void GoalPerceptor::findSpots(const int& height)
 	}
 }
 
-void GoalPerceptor::verticalColorScanDown()
+template<typename View>
+void GoalPerceptor::verticalColorScanDown(const View& image, Spot& spot)
 {
-	for(std::list<Spot>::iterator i = spots.begin(), end = spots.end(); i != end; ++i)
+	int totalPoints = 0;
+	int positivePoints = 0;
+
+	Vector2<int> mid = spot.mid;
+	Vector2<int> lastMid = Vector2<int>(0, 0);
+	int width = spot.width;
+	int baseY = 0;
+	const int baseLimit = postBaseLimit(spot);
+	int iterations = 0;
+	int budget = pixelBudget();
+
+	while(mid.x != lastMid.x && spot.start < mid.x && mid.x < spot.end && iterations++ < iterationLimit())
 	{
-	  int totalPoints = 0;
-	  int positivePoints = 0;
+		//-- Stop at the robot's own body, a base that reaches it is hidden (see isBaseHidden)
+		const int limit = std::min(baseLimit, bodyContourTop[mid.x]);
+		int noGaps = 2;
+		for(baseY = mid.y+1; baseY < limit && budget > 0; baseY++, budget--)
+		{
+			if(isWhite(image, mid.x, baseY))
+			{
+				noGaps++;
+			} else if(noGaps > 1)  {
+				noGaps = 0;
+			} else {
+				baseY -= 2;
+				break;
+			}
+		}
 
-		Vector2<int> mid = i->mid;
-		Vector2<int> lastMid = Vector2<int>(0, 0);
-		int width = i->width;
-		int baseY = 0;
+		//-- Calculate vote point
+		for (int vc=0; vc<15 && baseY+vc < std::min(image.height, bodyContourTop[mid.x]); vc+=3)
+		{
+		  DOT("module:GoalPerceptor:LowerPoint", mid.x, baseY+vc, ColorClasses::blue, ColorClasses::blue);
+		  totalPoints++;
+		  if (theColorReference.isGreen(image.pixel(mid.x, baseY+vc)))
+		    positivePoints+=100;
+		}
 
-		while(mid.x != lastMid.x && i->start < mid.x && mid.x < i->end)
+		LINE("module:GoalPerceptor:Scans", mid.x, mid.y, mid.x, baseY, 1, Drawings::ps_solid, ColorClasses::yellow);
+		lastMid = mid;
+		mid.y = mid.y + (baseY-mid.y)/2;
+		noGaps = 2;
+		int left = 1;
+		for(int x = mid.x; x > 1 && budget > 0; x--, budget--)
 		{
-			int noGaps = 2;
-			for(baseY = mid.y+1; baseY < theImage.height-1; baseY++)
+			if(isWhite(image, x, mid.y))
 			{
-				if(isWhite(mid.x, baseY))
-				{
-					noGaps++;
-				} else if(noGaps > 1)  {
-					noGaps = 0;
-				} else {
-					baseY -= 2;
-					break;
-				}
+				noGaps++;
 			}
-
-			//-- Calculate vote point
-			for (int vc=0; vc<15; vc+=3)
+			else if(noGaps > 1)
 			{
-			  DOT("module:GoalPerceptor:LowerPoint", mid.x, baseY+vc, ColorClasses::blue, ColorClasses::blue);
-			  totalPoints++;
-			  if (theColorReference.isGreen(theImage[baseY+vc]+mid.x))
-			    positivePoints+=100;
+				noGaps = 0;
 			}
-
-			LINE("module:GoalPerceptor:Scans", mid.x, mid.y, mid.x, baseY, 1, Drawings::ps_solid, ColorClasses::yellow);
-			lastMid = mid;
-			mid.y = mid.y + (baseY-mid.y)/2;
-			noGaps = 2;
-			int left = 1;
-			for(int x = mid.x; x > 1; x--)
+			else
 			{
-				if(isWhite(x, mid.y))
-				{
-					noGaps++;
-				}
-				else if(noGaps > 1)
-				{
-					noGaps = 0;
-				}
-				else
-				{
-					left = x+2;
-					break;
-				}
+				left = x+2;
+				break;
 			}
-			noGaps = 2;
-			width = theImage.width - left;
-			for(int x = mid.x; x < theImage.width-1; x++)
+		}
+		//-- A walk cut by the budget did not find the edge of the post, the last estimate is kept
+		if(budget <= 0)
+		{
+			mid = lastMid;
+			break;
+		}
+		noGaps = 2;
+		width = image.width - left;
+		for(int x = mid.x; x < image.width-1 && budget > 0; x++, budget--)
+		{
+			if(isWhite(image, x, mid.y))
 			{
-				if(isWhite(x, mid.y))
-				{
-					noGaps++;
-				}
-				else if(noGaps > 1)
-				{
-					noGaps = 0;
-				}
-				else
-				{
-					width = x-2 - left;
-					break;
-				}
+				noGaps++;
+			}
+			else if(noGaps > 1)
+			{
+				noGaps = 0;
+			}
+			else
+			{
+				width = x-2 - left;
+				break;
 			}
-			i->widths.push_back(width);
-			mid.x = left+width/2;
 		}
-		i->base = Vector2<int>(mid.x, baseY + 1);
-		i->votePoint = positivePoints / totalPoints;
-		CROSS("module:GoalPerceptor:Scans", i->base.x, i->base.y, 2, 2, Drawings::ps_solid, ColorClasses::red);
+		if(budget <= 0)
+		{
+			mid = lastMid;
+			break;
+		}
+		spot.widths.push_back(width);
+		mid.x = left+width/2;
 	}
+	if(budget <= 0 || iterations > iterationLimit())
+		reportScanLimit(spot);
+	spot.base = Vector2<int>(mid.x, baseY + 1);
+	spot.votePoint = totalPoints ? positivePoints / totalPoints : 0;
+	CROSS("module:GoalPerceptor:Scans", spot.base.x, spot.base.y, 2, 2, Drawings::ps_solid, ColorClasses::red);
 }
 
-void GoalPerceptor::verticalColorScanUp()
+template<typename View>
+void GoalPerceptor::verticalColorScanUp(const View& image, Spot& spot)
 {
-	for(std::list<Spot>::iterator i = spots.begin(), end = spots.end(); i != end; ++i)
+	Vector2<int> mid = spot.mid;
+	Vector2<int> lastMid = Vector2<int>(0, 0);
+	int width = spot.width;
+	int topY = 0;
+	const int topLimit = std::max(0, postTopLimit(spot.base));
+	int iterations = 0;
+	int budget = pixelBudget();
+
+	while(mid.y != lastMid.y && iterations++ < iterationLimit())
 	{
-		Vector2<int> mid = i->mid;
-		Vector2<int> lastMid = Vector2<int>(0, 0);
-		int width = i->width;
-		int initialWidth = 0;
-		int topY = 0;
-		int left = i->mid.x-width/2;
-		int right = i->mid.x+width/2;
-		int lastLeft;
-		int lastRight;
-		bool crossbarChecking = false;
-
-		while(mid.y != lastMid.y)
+		int noGaps = 2;
+		for(topY = mid.y-1; topY > topLimit && budget > 0; topY--, budget--)
 		{
-			int noGaps = 2;
-			for(topY = mid.y-1; topY > 0; topY--)
+			if(isWhite(image, mid.x, topY))
 			{
-				if(isWhite(mid.x, topY))
-				{
-					noGaps++;
-				}
-				else if(noGaps > 1)
-				{
-					noGaps = 0;
-				}
-				else
-				{
-					topY += 2;
-					break;
-				}
+				noGaps++;
 			}
-			LINE("module:GoalPerceptor:Scans", mid.x, mid.y, mid.x, topY, 1, Drawings::ps_solid, ColorClasses::yellow);
-			lastMid = mid;
-			mid.y = mid.y - (mid.y-topY)/2;
-			noGaps = 2;
-			lastLeft = left;
-			lastRight = right;
-			left = 1;
-			right = theImage.width-1;
-			for(int x = mid.x; x > 1; x--)
+			else if(noGaps > 1)
 			{
-				if(isWhite(x, mid.y))
-				{
-					noGaps++;
-				}
-				else if(noGaps > 1)
-				{
-					noGaps = 0;
-				}
-				else
-				{
-					left = x+2;
-					break;
-				}
+				noGaps = 0;
 			}
-			noGaps = 2;
-			for(int x = mid.x; x < theImage.width-1; x++)
+			else
 			{
-				if(isWhite(x, mid.y))
-				{
-					noGaps++;
-				}
-				else if(noGaps > 1)
-				{
-					noGaps = 0;
-				}
-				else
-				{
-					right = x-2;
-					width = right-left;
-					break;
-				}
+				topY += 2;
+				break;
 			}
-			if(!initialWidth)
+		}
+		LINE("module:GoalPerceptor:Scans", mid.x, mid.y, mid.x, topY, 1, Drawings::ps_solid, ColorClasses::yellow);
+		lastMid = mid;
+		mid.y = mid.y - (mid.y-topY)/2;
+
+		//-- Re-center on the post. The walks do not follow a crossbar, scanCrossbar finds it once for all spots
+		const int leftLimit = std::max(1, mid.x-width);
+		const int rightLimit = std::min(image.width-1, mid.x+width);
+		int left = leftLimit;
+		int right = rightLimit;
+		noGaps = 2;
+		for(int x = mid.x; x > leftLimit && budget > 0; x--, budget--)
+		{
+			if(isWhite(image, x, mid.y))
 			{
-				if(lastLeft > 1 && lastRight < theImage.width-2)
-				{
-					initialWidth = width;
-					crossbarChecking = true;
-				}
+				noGaps++;
 			}
-			if(crossbarChecking)
+			else if(noGaps > 1)
 			{
-				if(lastLeft-left > initialWidth && abs(right-lastRight) < initialWidth)
-				{
-					i->top = Vector2<int>(mid.x, topY);
-					i->leftRight = GoalPost::Position::IS_RIGHT;
-					LINE("module:GoalPerceptor:Scans", mid.x, mid.y, left, mid.y, 1, Drawings::ps_solid, ColorClasses::yellow);
-					goto end_vcs_up;
-				}
-				else if(right-lastRight > initialWidth && abs(left-lastLeft) < initialWidth)
-				{
-					i->top = Vector2<int>(mid.x, topY);
-					i->leftRight = GoalPost::Position::IS_LEFT;
-					LINE("module:GoalPerceptor:Scans", mid.x, mid.y, right, mid.y, 1, Drawings::ps_solid, ColorClasses::yellow);
-					goto end_vcs_up;
-				}
+				noGaps = 0;
+			}
+			else
+			{
+				left = x+2;
+				break;
 			}
-			mid.x = left+width/2;
 		}
-		i->leftRight = GoalPost::Position::IS_UNKNOWN;
-		end_vcs_up:
-		i->top = Vector2<int>(mid.x, topY + 1);
-		CROSS("module:GoalPerceptor:Scans", i->top.x, i->top.y, 2, 2, Drawings::ps_solid, ColorClasses::orange);
-	}
-}
-
-void GoalPerceptor::bottomCorrector()
-{
-	for (std::list<Spot>::iterator it=spots.begin(); it!=spots.end(); it++)
-	{
-		int noGaps = 2;
-		int botY;
-		for(botY = it->base.y-5; botY < theImage.height-1; botY++)
+		noGaps = 2;
+		for(int x = mid.x; x < rightLimit && budget > 0; x++, budget--)
 		{
-			if(isInGrad(it->base.x, botY, 10)) {
+			if(isWhite(image, x, mid.y))
+			{
 				noGaps++;
-			} else if(noGaps > 1) {
+			}
+			else if(noGaps > 1)
+			{
 				noGaps = 0;
-			} else {
-				botY -= 2;
+			}
+			else
+			{
+				right = x-2;
 				break;
 			}
 		}
 
-		it->base.y = botY;
+		//-- The row is much wider than the post, the crossbar (or the background) is reached
+		if(left == leftLimit || right == rightLimit)
+			break;
+		width = right-left;
+		mid.x = left+width/2;
 	}
+	if(budget <= 0 || iterations > iterationLimit())
+		reportScanLimit(spot);
+	spot.leftRight = GoalPost::Position::IS_UNKNOWN;
+	spot.top = Vector2<int>(mid.x, topY + 1);
+	CROSS("module:GoalPerceptor:Scans", spot.top.x, spot.top.y, 2, 2, Drawings::ps_solid, ColorClasses::orange);
+}
+
+template<typename View>
+void GoalPerceptor::scanCrossbar(const View& image)
+{
+  if (spots.empty())
+    return;
+
+  std::vector<Spot*> posts;
+  for (Spot& s : spots)
+    posts.push_back(&s);
+  std::sort(posts.begin(), posts.end(), [](const Spot* a, const Spot* b) { return a->top.x < b->top.x; });
+
+  //-- The crossbar runs from top to top. The scan follows the line through the tops, half a post width below
+  //   them (the middle of the crossbar), and goes on at the level of the outer tops as far as a crossbar must be seen
+  auto rowAt = [&](int x, size_t next) -> int
+  {
+    const Spot* b = posts[std::min(next, posts.size()-1)];
+    const Spot* a = next ? posts[next-1] : b;
+    const int ya = a->top.y + a->width/2;
+    const int yb = b->top.y + b->width/2;
+    const int y = (next == 0 || next == posts.size() || a->top.x == b->top.x) ? ya : ya + (yb-ya)*(x-a->top.x)/(b->top.x-a->top.x);
+    return std::max(0, std::min(image.height-1, y));
+  };
+
+  const int first = std::max(1, posts.front()->top.x - 2*posts.front()->width - 2);
+  const int last = std::min(image.width-2, posts.back()->top.x + 2*posts.back()->width + 2);
+
+  std::vector<Vector2<int> > runs; //-- first and last column of each white run
+  int runStart = -1, lastWhite = -1;
+  size_t next = 0;
+  for (int x = first; x <= last; x++)
+  {
+    while (next < posts.size() && posts[next]->top.x <= x)
+      next++;
+    if (!isWhite(image, x, rowAt(x, next)))
+      continue;
+    //-- A single pixel gap is not the end of a run
+    if (runStart < 0 || x - lastWhite > 2)
+    {
+      if (runStart >= 0)
+        runs.push_back(Vector2<int>(runStart, lastWhite));
+      runStart = x;
+    }
+    lastWhite = x;
+  }
+  if (runStart >= 0)
+    runs.push_back(Vector2<int>(runStart, lastWhite));
+
+  //-- A post is left of the crossbar if its run reaches further right than a post width, and vice versa
+  for (Spot* s : posts)
+  {
+    for (const Vector2<int>& run : runs)
+    {
+      if (run.x > s->top.x || run.y < s->top.x)
+        continue;
+      const bool right = run.y > s->top.x + s->width/2 + s->width;
+      const bool left = run.x < s->top.x - s->width/2 - s->width;
+      if (right != left)
+        s->leftRight = right ? GoalPost::Position::IS_LEFT : GoalPost::Position::IS_RIGHT;
+      break;
+    }
+  }
+
+  COMPLEX_DRAWING("module:GoalPerceptor:Scans",
+  {
+    for (const Vector2<int>& run : runs)
+    {
+      size_t a = 0;
+      size_t b = 0;
+      while (a < posts.size() && posts[a]->top.x <= run.x)
+        a++;
+      while (b < posts.size() && posts[b]->top.x <= run.y)
+        b++;
+      LINE("module:GoalPerceptor:Scans", run.x, rowAt(run.x, a), run.y, rowAt(run.y, b), 1, Drawings::ps_solid, ColorClasses::yellow);
+    }
+  });
+}
+
+template<typename View>
+void GoalPerceptor::refineBase(const View& image, Spot& spot)
+{
+  //-- Luminance profile and its central differences, 3 columns averaged against the noise
+  const int window = std::max(1, std::min(baseRefinementWindow, 16));
+  int profile[2*16 + 3];
+  int gradient[2*16 + 3];
+
+  const int x = std::max(1, std::min(image.width-2, spot.base.x));
+  const int first = spot.base.y - window - 1;
+  const int last = spot.base.y + window + 1;
+  if (first < 0 || last >= std::min(image.height, bodyContourTop[x]))
+    return;
+
+  for (int y = first; y <= last; y++)
+    profile[y-first] = image.luma(x-1, y) + image.luma(x, y) + image.luma(x+1, y);
+
+  //-- The post is brighter than the ground, so the base is the strongest falling edge
+  int edge = -1;
+  for (int y = first+1; y < last; y++)
+  {
+    gradient[y-first] = profile[y-first+1] - profile[y-first-1];
+    if (edge < 0 || gradient[y-first] < gradient[edge-first])
+      edge = y;
+  }
+  if (-gradient[edge-first] < 3 * minBaseGradient || edge == first+1 || edge == last-1)
+    return;
+
+  //-- Parabola through the gradient around its minimum
+  const float g0 = (float)gradient[edge-first-1];
+  const float g1 = (float)gradient[edge-first];
+  const float g2 = (float)gradient[edge-first+1];
+  const float curvature = g0 - 2.f * g1 + g2;
+  const float offset = curvature > 0.f ? std::max(-0.5f, std::min(0.5f, (g0 - g2) / (2.f * curvature))) : 0.f;
+
+  spot.base.y = edge;
+  spot.baseOffset = offset;
+  spot.refined = true;
+  LINE("module:GoalPerceptor:LowerPoint", x-3, edge, x+3, edge, 1, Drawings::ps_solid, ColorClasses::red);
 }
 
-void GoalPerceptor::calculatePosition(const int& height)
+void GoalPerceptor::calculatePosition(Spot& spot, const int& height)
 {
-	for(std::list<Spot>::iterator i = spots.begin(), end = spots.end(); i != end; ++i)
+	if (spot.base.y > theImage.height-5)
 	{
-		if (i->base.y > theImage.height-5)
+		//-- The base is cut by the image, a post seen by either camera in these columns has the better position
+		bool matching = false;
+		Vector2<> lastPosition;
+		int observations = 0;
+		const std::vector<GoalPostMemory::Prior>& priors = postMemory.getPriors();
+		for(std::vector<GoalPostMemory::Prior>::const_iterator p = postMemory.firstRightOf(spot.start); p != priors.end() && p->inImage.x < spot.end; ++p)
 		{
-			bool matching = false;
-			Vector2<> lastPosition;
-			if(theCameraInfo.camera == CameraInfo::upper)
+			Vector2<int> intersection;
+			Geometry::Line l1 = Geometry::Line(Vector2<int>(spot.start, height), (Vector2<int>(spot.end, height) - Vector2<int>(spot.start, height)));
+			Geometry::Line l2 = Geometry::Line(p->inImage, (spot.base - p->inImage));
+			Geometry::getIntersectionOfLines(l1, l2, intersection);
+			if(intersection.x < spot.end && intersection.x > spot.start && p->observations > observations)
 			{
-				Vector2<int> projection;
-				for(unsigned e = 0; e < lastPosts.size(); e++)
-				{
-					Vector2<> updated = lastPosts[e].position;
-					updated = updated.rotate(-theOdometer.odometryOffset.rotation);
-					updated -= theOdometer.odometryOffset.translation;
-					Geometry::calculatePointInImage(updated, theCameraMatrix, theCameraInfo, projection);
-					if(projection.x < i->end && projection.x > i->start)
-					{
-						Vector2<int> intersection;
-						Geometry::Line l1 = Geometry::Line(Vector2<int>(i->start, height), (Vector2<int>(i->end, height) - Vector2<int>(i->start, height)));
-						Geometry::Line l2 = Geometry::Line(projection, (i->base - projection));
-						Geometry::getIntersectionOfLines(l1, l2, intersection);
-						if(intersection.x < i->end && intersection.x > i->start)
-						{
-							matching = true;
-							lastPosition = updated;
-						}
-					}
-				}
-			}
-			if(matching)
-			{
-				i->position = lastPosition;
-			}
-			else
-			{
-				float distance = Geometry::getDistanceBySize(theCameraInfo, theFieldDimensions.goalPostRadius * 2.f, (float)i->width);
-				Vector2<> angle;
-				Geometry::calculateAnglesForPoint(Vector2<>(i->mid), theCameraMatrix, theCameraInfo, angle);
-				i->position = Vector2<>(std::cos(angle.x), std::sin(angle.x)) * distance;
+				matching = true;
+				lastPosition = p->position;
+				observations = p->observations;
 			}
 		}
+		if(matching)
+		{
+			spot.position = lastPosition;
+		}
 		else
 		{
-			Vector2<> pCorrected = theImageCoordinateSystem.toCorrected(Vector2<int>((i->start + i->end)/2.f, i->base.y));
-			Geometry::calculatePointOnField((int)pCorrected.x, (int)pCorrected.y, theCameraMatrix, theCameraInfo, i->position);
+			float distance = Geometry::getDistanceBySize(theCameraInfo, theFieldDimensions.goalPostRadius * 2.f, (float)spot.width);
+			Vector2<> angle;
+			Geometry::calculateAnglesForPoint(Vector2<>(spot.mid), theCameraMatrix, theCameraInfo, angle);
+			spot.position = Vector2<>(std::cos(angle.x), std::sin(angle.x)) * distance;
 		}
 	}
+	else
+	{
+		Vector2<> pCorrected = theImageCoordinateSystem.toCorrected(Vector2<int>((spot.start + spot.end)/2.f, spot.base.y));
+		pCorrected.y += spot.baseOffset;
+
+		//-- The rows next to a sub-pixel base are projected and interpolated
+		const int row = (int)std::floor(pCorrected.y);
+		const float fraction = pCorrected.y - row;
+		Vector2<> upper, lower;
+		if (spot.refined && fraction > 0.f && Geometry::calculatePointOnField((int)pCorrected.x, row, theCameraMatrix, theCameraInfo, upper) &&
+		    Geometry::calculatePointOnField((int)pCorrected.x, row + 1, theCameraMatrix, theCameraInfo, lower))
+			spot.position = upper + (lower - upper) * fraction;
+		else
+			Geometry::calculatePointOnField((int)pCorrected.x, (int)pCorrected.y, theCameraMatrix, theCameraInfo, spot.position);
+	}
 }
 
-void GoalPerceptor::validate()
+void GoalPerceptor::scoreSpot(Spot& spot)
 {
 	int distanceEvaluation;
 	int relationWidthToHeight;
@@ -515,63 +1132,102 @@ void GoalPerceptor::validate()
 	int constantWidth;
 	int expectedWidth;
 	int expectedHeight;
-	int distanceToEachOther;
-	int matchingCrossbars;
 
 	int height;
 	float value;
 	float expectedValue;
 	float maxDistance = (Vector2<>(theFieldDimensions.xPosOpponentFieldBorder, theFieldDimensions.yPosLeftFieldBorder) - Vector2<>(theFieldDimensions.xPosOwnFieldBorder, theFieldDimensions.yPosRightFieldBorder)).abs() * 1.3f;
 
-	for(std::list<Spot>::iterator i = spots.begin(); i != spots.end(); i++)
-	{
-		height = (i->base - i->top).abs();
+	height = (spot.base - spot.top).abs();
 
-		// if goal post is too far away or too near this post gets 0 %
-		i->position.abs() > maxDistance || i->position.abs() < theFieldDimensions.goalPostRadius ? distanceEvaluation = 0 : distanceEvaluation = 1;
+	// if goal post is too far away or too near this post gets 0 %
+	spot.position.abs() > maxDistance || spot.position.abs() < theFieldDimensions.goalPostRadius ? distanceEvaluation = 0 : distanceEvaluation = 1;
 
-		// minimum height
-		height < Geometry::getSizeByDistance(theCameraInfo, theFieldDimensions.goalHeight, maxDistance) ? minimalHeight = 0 : minimalHeight = 1;
+	// minimum height
+	height < Geometry::getSizeByDistance(theCameraInfo, theFieldDimensions.goalHeight, maxDistance) ? minimalHeight = 0 : minimalHeight = 1;
 
-		// if goal post base is above the field border
-		value = (float)theFieldBoundary.getBoundaryY(i->base.x);
-		i->base.y > value - (value / 20) ? belowFieldBorder = 1 : belowFieldBorder = 0;
+	// if goal post base is above the field border
+	value = (float)theFieldBoundary.getBoundaryY(spot.base.x);
+	spot.base.y > value - (value / 20) ? belowFieldBorder = 1 : belowFieldBorder = 0;
 
-		// if all width of the goal posts are alike
-		constantWidth = 1;
-		// [FIXME] : Since the goal posts are not white any more, the edge detection
-		//           is not working same as it was before. Hence, the width validation
-		//           is not used.
-		//    for(int w : i->widths){if(w > i->width * 2) constantWidth = 0;}
+	// if all width of the goal posts are alike
+	constantWidth = 1;
+	// [FIXME] : Since the goal posts are not white any more, the edge detection
+	//           is not working same as it was before. Hence, the width validation
+	//           is not used.
+	//    for(int w : spot.widths){if(w > spot.width * 2) constantWidth = 0;}
 
-		// goal posts relation of height to width
-		value = ((float)height) / i->width;
-		expectedValue = theFieldDimensions.goalHeight / (theFieldDimensions.goalPostRadius * 2);
-		relationWidthToHeight = (int)(100 - (std::abs(expectedValue - value) / expectedValue) * 50);
+	// goal posts relation of height to width
+	value = ((float)height) / spot.width;
+	expectedValue = theFieldDimensions.goalHeight / (theFieldDimensions.goalPostRadius * 2);
+	relationWidthToHeight = (int)(100 - (std::abs(expectedValue - value) / expectedValue) * 50);
 
-		// distance compared to width
-		expectedValue = Geometry::getSizeByDistance(theCameraInfo, theFieldDimensions.goalPostRadius * 2, i->position.abs());
-		
-		// clipping with left image limit
-		if(i->base.x < (expectedValue / 2))
-			expectedValue -= ((expectedValue / 2) - i->base.x);
+	// distance compared to width
+	expectedValue = Geometry::getSizeByDistance(theCameraInfo, theFieldDimensions.goalPostRadius * 2, spot.position.abs());
+	
+	// clipping with left image limit
+	if(spot.base.x < (expectedValue / 2))
+		expectedValue -= ((expectedValue / 2) - spot.base.x);
 
-		// clipping with right image limit
-		if(((theImage.width - 1) - i->base.x) < (expectedValue / 2))
-			expectedValue -= ((expectedValue / 2) - ((theImage.width - 1) - i->base.x));
-		expectedWidth = (int)(100 - (std::abs(expectedValue - i->width) / expectedValue) * 50);
+	// clipping with right image limit
+	if(((theImage.width - 1) - spot.base.x) < (expectedValue / 2))
+		expectedValue -= ((expectedValue / 2) - ((theImage.width - 1) - spot.base.x));
+	expectedWidth = (int)(100 - (std::abs(expectedValue - spot.width) / expectedValue) * 50);
 
-		// distance compared to height
-		expectedValue = Geometry::getSizeByDistance(theCameraInfo, theFieldDimensions.goalHeight, i->position.abs());
+	// distance compared to height
+	expectedValue = Geometry::getSizeByDistance(theCameraInfo, theFieldDimensions.goalHeight, spot.position.abs());
+	
+	// clipping with upper image limit
+	if(spot.base.y < expectedValue)
+		expectedValue -= (expectedValue - spot.base.y);
 		
-		// clipping with upper image limit
-		if(i->base.y < expectedValue)
-			expectedValue -= (expectedValue - i->base.y);
-			
-		// clipping with lower image limit
-		if(((theImage.height - 1) - i->top.y) < expectedValue)
-			expectedValue -= (expectedValue - ((theImage.height - 1) - i->top.y));
-		expectedHeight = (int)(100 - (std::abs(expectedValue - height) / expectedValue) * 50);
+	// clipping with lower image limit
+	if(((theImage.height - 1) - spot.top.y) < expectedValue)
+		expectedValue -= (expectedValue - ((theImage.height - 1) - spot.top.y));
+	expectedHeight = (int)(100 - (std::abs(expectedValue - height) / expectedValue) * 50);
+
+	if(relationWidthToHeight < 0)
+		relationWidthToHeight *= 3;
+	if(expectedWidth < 0)
+		expectedWidth *= 3;
+	if(expectedHeight < 0)
+		expectedHeight *= 3;
+
+	spot.ownScore = (float)(relationWidthToHeight +
+	                        expectedWidth
+	                        /* + expectedHeight */); // [FIXME] : This is commented because our head control engine
+	                                                 //           is always looks down, though it can not see top of 
+	                                                 //           the goal posts. So, it does not make any sence...
+	spot.plausible = distanceEvaluation * minimalHeight * belowFieldBorder * constantWidth != 0;
+
+	//-- Debugging:
+	{
+		DRAWTEXT("module:GoalPerceptor:Validation", spot.mid.x, -spot.mid.y - 55, 10, ColorClasses::black, "distanceEvaluation: " << distanceEvaluation);
+		DRAWTEXT("module:GoalPerceptor:Validation", spot.mid.x, -spot.mid.y - 44, 10, ColorClasses::black, "minimalHeight: " << minimalHeight);
+		DRAWTEXT("module:GoalPerceptor:Validation", spot.mid.x, -spot.mid.y - 33, 10, ColorClasses::black, "belowFieldBorder: " << belowFieldBorder);
+		DRAWTEXT("module:GoalPerceptor:Validation", spot.mid.x, -spot.mid.y - 22, 10, ColorClasses::black, "constantWidth: " << constantWidth);
+		DRAWTEXT("module:GoalPerceptor:Validation", spot.mid.x, -spot.mid.y - 11, 10, ColorClasses::black, "relationWidthToHeight: " << relationWidthToHeight);
+		DRAWTEXT("module:GoalPerceptor:Validation", spot.mid.x, -spot.mid.y     , 10, ColorClasses::black, "expectedWidth: " << expectedWidth);
+		DRAWTEXT("module:GoalPerceptor:Validation", spot.mid.x, -spot.mid.y + 11, 10, ColorClasses::black, "expectedHeight: " << expectedHeight);
+	}
+}
+
+void GoalPerceptor::validate()
+{
+	int distanceToEachOther;
+	int matchingCrossbars;
+
+	float value;
+	float expectedValue;
+
+	//-- The checks of each spot alone are done by scoreSpot, only the checks against the other spots are left
+	for(std::list<Spot>::iterator i = spots.begin(); i != spots.end(); i++)
+	{
+		if(!i->plausible)
+		{
+			i->validity = 0;
+			continue;
+		}
 
 		distanceToEachOther = quality;
 		matchingCrossbars = quality;
@@ -592,25 +1248,7 @@ void GoalPerceptor::validate()
 			}
 		}
 
-		if(relationWidthToHeight < 0)
-			relationWidthToHeight *= 3;
-		if(expectedWidth < 0)
-			expectedWidth *= 3;
-		if(expectedHeight < 0)
-			expectedHeight *= 3;
-
-		i->validity = ((relationWidthToHeight +
-		                expectedWidth +
-		                /*expectedHeight + */ // [FIXME] : This is commented because our head control engine
-		                                      //           is always looks down, though it can not see top of 
-		                                      //           the goal posts. So, it does not make any sence...
-		                distanceToEachOther +
-		                matchingCrossbars) / 5.0f) *
-		                
-		                distanceEvaluation *
-		                minimalHeight *
-		                belowFieldBorder *
-		                constantWidth;
+		i->validity = (i->ownScore + distanceToEachOther + matchingCrossbars) / 5.0f;
 
 		int low = 0;
 		int high = 110;
@@ -619,13 +1257,6 @@ void GoalPerceptor::validate()
 
 		//-- Debugging:
 		{
-			DRAWTEXT("module:GoalPerceptor:Validation", i->mid.x, -i->mid.y - 55, 10, ColorClasses::black, "distanceEvaluation: " << distanceEvaluation);
-			DRAWTEXT("module:GoalPerceptor:Validation", i->mid.x, -i->mid.y - 44, 10, ColorClasses::black, "minimalHeight: " << minimalHeight);
-			DRAWTEXT("module:GoalPerceptor:Validation", i->mid.x, -i->mid.y - 33, 10, ColorClasses::black, "belowFieldBorder: " << belowFieldBorder);
-			DRAWTEXT("module:GoalPerceptor:Validation", i->mid.x, -i->mid.y - 22, 10, ColorClasses::black, "constantWidth: " << constantWidth);
-			DRAWTEXT("module:GoalPerceptor:Validation", i->mid.x, -i->mid.y - 11, 10, ColorClasses::black, "relationWidthToHeight: " << relationWidthToHeight);
-			DRAWTEXT("module:GoalPerceptor:Validation", i->mid.x, -i->mid.y     , 10, ColorClasses::black, "expectedWidth: " << expectedWidth);
-			DRAWTEXT("module:GoalPerceptor:Validation", i->mid.x, -i->mid.y + 11, 10, ColorClasses::black, "expectedHeight: " << expectedHeight);
 			DRAWTEXT("module:GoalPerceptor:Validation", i->mid.x, -i->mid.y + 22, 10, ColorClasses::black, "distanceToEachOther: " << distanceToEachOther);
 			DRAWTEXT("module:GoalPerceptor:Validation", i->mid.x, -i->mid.y + 33, 10, ColorClasses::black, "matchingCrossbars: " << matchingCrossbars);
 			DRAWTEXT("module:GoalPerceptor:Validation", i->mid.x, -i->mid.y + 44, 10, ColorClasses::black, "validity: " << i->validity);
@@ -633,22 +1264,115 @@ void GoalPerceptor::validate()
 	}
 	
 	spots.sort();
+
+	//-- After the sort, so the duplicate with the higher validity is kept
+	removeDuplicates();
 }
 
-void GoalPerceptor::removeNotGoalposts()
+void GoalPerceptor::rasterizeBodyContour()
 {
-  for (std::list<Spot>::iterator i = spots.begin(); i!=spots.end(); )
+  bodyContourTop.resize(theImage.width);
+  for (int x=0; x<theImage.width; x++)
   {
-    bool shouldBeDeleted = false;
+    //-- Rows from here on (and beyond the image, if the body is not in this column) show the robot itself
+    int y = theImage.height;
+    theBodyContour.clipBottom(x, y);
+    bodyContourTop[x] = y;
+  }
+}
+
+void GoalPerceptor::updateColorTable()
+{
+  if (!colorTable)
+  {
+    whiteTable.reset();
+    return;
+  }
 
-    //-- Check for body contour
-    int hackForBodyContourFunction = i->base.y;
-    theBodyContour.clipBottom(i->base.x, hackForBodyContourFunction);
-    if (i->base.y != hackForBodyContourFunction)
+  //-- The builder never touches a table after publishing it, so the swap is all it takes
+  if (GoalColorTable* table = colorTableBuilder.take())
+    whiteTable.reset(table);
+
+  if ((!timeWhenColorTableRequested || theFrameInfo.getTimeSince(timeWhenColorTableRequested) >= colorTableRebuildInterval) &&
+      colorTableBuilder.request(theColorReference, colorStatistics, colorTableMinHits))
+  {
+    timeWhenColorTableRequested = theFrameInfo.time;
+    colorStatistics.decay();
+  }
+}
+
+void GoalPerceptor::collectColorStatistics()
+{
+  //-- The spots are sorted by validity, the best two are the ones to be posted. Only a complete goal
+  //   whose posts are a goal width apart is counted, a single post may be what the table made up.
+  if (spots.size() < 2)
+    return;
+  const Spot& first = spots.back();
+  const Spot& second = *std::next(spots.rbegin());
+  const float goalWidth = std::abs(theFieldDimensions.yPosLeftGoal) * 2.f;
+  const float deviation = std::abs((first.position - second.position).abs() - goalWidth) / goalWidth;
+  if (second.validity <= quality || (int)(100 - deviation * 50) <= 75)
+    return;
+
+  for (const Spot* s : {&first, &second})
+  {
+    const int x = s->mid.x;
+    for (int y = std::max(0, s->top.y); y < std::min(s->base.y, bodyContourTop[x]); y += 4)
+      colorStatistics.addPost(theImage[y][x]);
+    for (int y = s->base.y + 4; y <= s->base.y + 16 && y < bodyContourTop[x]; y += 4)
+      colorStatistics.addGreen(theImage[y][x]);
+  }
+}
+
+void GoalPerceptor::memoizeSpotColumns()
+{
+  //-- The re-centering walks stay within a post width of the post, the scan down a bit more
+  spotMemo.reset(theImage.width, theImage.height);
+  for (const Spot& s : spots)
+    spotMemo.addBand(s.mid.x - 2*s.width - 4, s.mid.x + 2*s.width + 4, maxMemoColumns);
+  spotMemo.commit();
+}
+
+void GoalPerceptor::maskRobotColumns()
+{
+  robotMaskTop.assign(theImage.width, theImage.height);
+  robotMaskBottom.assign(theImage.width, -1);
+  if (!excludeRobotColumns)
+    return;
+
+  for (auto& r : theRobotPercept.robots)
+  {
+    if (!r.detectedJersey)
+      continue;
+
+    //-- Same columns as in rejectRobot, all rows or only the rows of the robot's box
+    const int top = partialRobotExclusion ? std::max(0, r.y1) : 0;
+    const int bottom = partialRobotExclusion ? std::min(theImage.height-1, r.y2) : theImage.height-1;
+    for (int x=std::max(0, r.x1+1); x<std::min(theImage.width, r.x2); x++)
     {
-      CROSS("module:GoalPerceptor:removals", i->base.x, i->base.y, 5, 5, Drawings::bs_solid, ColorRGBA(100, 10, 10)); //-- Dark Red
-      shouldBeDeleted = true;
+      robotMaskTop[x] = std::min(robotMaskTop[x], top);
+      robotMaskBottom[x] = std::max(robotMaskBottom[x], bottom);
     }
+    LINE("module:GoalPerceptor:removals", r.x1, top, r.x2, top, 1, Drawings::ps_dash, ColorRGBA(10, 10, 120));
+    LINE("module:GoalPerceptor:removals", r.x1, bottom, r.x2, bottom, 1, Drawings::ps_dash, ColorRGBA(10, 10, 120));
+  }
+}
+
+bool GoalPerceptor::isBaseHidden(const Spot& spot)
+{
+  //-- Check for body contour, at the base as it is clipped to the spot later
+  const int x = std::max(spot.base.x, spot.start);
+  if (spot.base.y <= bodyContourTop[x])
+    return false;
+  CROSS("module:GoalPerceptor:removals", x, spot.base.y, 5, 5, Drawings::bs_solid, ColorRGBA(100, 10, 10)); //-- Dark Red
+  return true;
+}
+
+void GoalPerceptor::removeDuplicates()
+{
+  for (std::list<Spot>::iterator i = spots.begin(); i!=spots.end(); )
+  {
+    bool shouldBeDeleted = false;
 
     //-- Check for duplications
     for (std::list<Spot>::iterator j=i; !shouldBeDeleted && j!=spots.end(); j++)
@@ -677,7 +1401,6 @@ void GoalPerceptor::posting(GoalPercept& percept)
 				CROSS("module:GoalPerceptor:MidPoints", s.mid.x, s.mid.y, 3, 3, Drawings::ps_solid, ColorClasses::orange);
 	});
 
-	lastPosts.clear();
 	if(!spots.empty())
 	{
 		Spot first = spots.back();
@@ -710,32 +1433,34 @@ void GoalPerceptor::posting(GoalPercept& percept)
 					}
 					percept.goalPosts.push_back(p2);
 					percept.timeWhenCompleteGoalLastSeen = theFrameInfo.time;
-					if(theCameraInfo.camera == CameraInfo::lower)
-						lastPosts.push_back(second);
+					if(second.base.y <= theImage.height-5)
+						postMemory.add(second.position, theFrameInfo.time, postMemoryMergeDistance);
 				}
 			}
 			percept.goalPosts.push_back(p1);
 			percept.timeWhenGoalPostLastSeen = theFrameInfo.time;
-			if(theCameraInfo.camera == CameraInfo::lower)
-				lastPosts.push_back(first);
+			if(first.base.y <= theImage.height-5)
+				postMemory.add(first.position, theFrameInfo.time, postMemoryMergeDistance);
 		}
 	}
+
+	//-- Remember the complete goal of the lower camera for the adaptive scheduling
+	if(theCameraInfo.camera == CameraInfo::lower && percept.goalPosts.size() == 2)
+	{
+		completeGoal = percept.goalPosts;
+		timeWhenCompleteGoalMeasured = theFrameInfo.time;
+		odometrySinceCompleteGoal = Pose2D();
+		headAnglesOfCompleteGoal = Vector2<>(theFilteredJointData.angles[JointData::HeadYaw], theFilteredJointData.angles[JointData::HeadPitch]);
+	}
 }
 
-void GoalPerceptor::calculateVotePoints()
+bool GoalPerceptor::hasLowVotePoint(const Spot& spot)
 {
-  for (std::list<Spot>::iterator i=spots.begin(); i!=spots.end();)
-  {
-    //-- Removing noise from the list
-    if (i->votePoint < minVotePoint)
-    {
-      CROSS("module:GoalPerceptor:removals", i->base.x, i->base.y, 3, 3, Drawings::bs_solid, ColorClasses::green);
-      DRAWTEXT("module:GoalPerceptor:removals", i->base.x, -i->base.y + 7, 5, ColorClasses::green, i->votePoint);
-      i = spots.erase(i);
-    }
-    else
-      i++;
-  }
+  if (spot.votePoint >= minVotePoint)
+    return false;
+  CROSS("module:GoalPerceptor:removals", spot.base.x, spot.base.y, 3, 3, Drawings::bs_solid, ColorClasses::green);
+  DRAWTEXT("module:GoalPerceptor:removals", spot.base.x, -spot.base.y + 7, 5, ColorClasses::green, spot.votePoint);
+  return true;
 }
 
 void GoalPerceptor::rejectRobot()
@@ -762,19 +1487,43 @@ void GoalPerceptor::rejectRobot()
 	}
 }
 
-inline bool GoalPerceptor::isWhite(const int& x, const int& y)
+inline bool GoalPerceptor::isRobotExcluded(int x, int y) const
+{
+	return robotMaskTop[x] <= y && y <= robotMaskBottom[x];
+}
+
+template<typename View>
+inline bool GoalPerceptor::isWhite(const View& image, const int& x, const int& y)
+{
+	return y < bodyContourTop[x] && !isRobotExcluded(x, y) && isWhiteColor(image, x, y);
+}
+
+template<typename View>
+inline bool GoalPerceptor::isWhiteColor(const View& image, int x, int y) const
+{
+	return whiteTable ? whiteTable->isWhite(image.luma(x, y), image.cb(x, y), image.cr(x, y)) : theColorReference.isYellow(image.pixel(x, y));
+}
+
+template<typename View>
+inline bool GoalPerceptor::isWhiteColor(const GoalImageView::Memoized<View>& image, int x, int y) const
 {
-	return theColorReference.isYellow(&theImage[y][x]);
+	unsigned char* c = image.memo.at(x, y);
+	if (!c)
+		return isWhiteColor(image.view, x, y);
+	if (!image.memo.isKnown(*c))
+		*c = image.memo.classified(isWhiteColor(image.view, x, y));
+	return GoalImageView::ClassificationMemo::isWhite(*c);
 }
 
-inline bool GoalPerceptor::isInGrad(int px, int py, unsigned char& Y, unsigned char& Cr, unsigned char& Cb)
+template<typename View>
+inline bool GoalPerceptor::isInGrad(const View& image, int px, int py, unsigned char& Y, unsigned char& Cr, unsigned char& Cb)
 {
-	if (!theColorReference.isYellow(&theImage[py][px]))
+	if (py >= bodyContourTop[px] || isRobotExcluded(px, py) || !isWhiteColor(image, px, py))
 		return false;
 
-	const float y  = theImage[py][px].y;
-	const float cr = theImage[py][px].cr;
-	const float cb = theImage[py][px].cb;
+	const float y  = image.luma(px, py);
+	const float cr = image.cr(px, py);
+	const float cb = image.cb(px, py);
 
 	const float diff2 = (y-Y)*(y-Y) + (y-Y)*(y-Y) + (cr-Cr)*(cr-Cr) + (cb-Cb)*(cb-Cb);
 
@@ -9,6 +9,7 @@
 #include "Tools/Math/Geometry.h"
 #include "Tools/Module/Module.h"
 #include "Representations/Perception/GoalPercept.h"
+#include "Representations/Perception/PredictedGoalPercept.h"
 #include "Representations/Perception/ImageCoordinateSystem.h"
 #include "Representations/Perception/CameraMatrix.h"
 #include "Representations/Perception/FieldBoundary.h"
@@ -16,11 +17,18 @@
 #include "Representations/Infrastructure/Image.h"
 #include "Representations/Infrastructure/CameraInfo.h"
 #include "Representations/Infrastructure/FrameInfo.h"
+#include "Representations/Infrastructure/JointData.h"
 #include "Representations/Modeling/Odometer.h"
 #include "Tools/Debugging/DebugDrawings.h"
 #include "Representations/Perception/ColorReference.h"
 #include "Representations/Perception/RobotPercept.h"
 #include "Representations/Perception/BodyContour.h"
+#include "GoalImageView.h"
+#include "GoalFlightRecorder.h"
+#include "GoalStripWorkers.h"
+#include "GoalColorTable.h"
+#include "GoalPostMemory.h"
+#include <memory>
 
 MODULE(GoalPerceptor)
   REQUIRES(CameraMatrix)
@@ -34,11 +42,51 @@ MODULE(GoalPerceptor)
   REQUIRES(Odometer)
   REQUIRES(RobotPercept)
   REQUIRES(BodyContour)
+  REQUIRES(FilteredJointData)
   PROVIDES_WITH_MODIFY_AND_DRAW(GoalPercept)
+  PROVIDES_WITH_DRAW(PredictedGoalPercept)
   LOADS_PARAMETER(int, quality)
   LOADS_PARAMETER(int, yellowSkipping)
   LOADS_PARAMETER(int, colorDifferenceValue)
   LOADS_PARAMETER(float, minVotePoint)
+  LOADS_PARAMETER(bool, adaptiveScheduling) /// Skip the upper camera while the lower camera holds the complete goal
+  LOADS_PARAMETER(int, maxPredictionAge) /// Time (ms) a complete goal of the lower camera may replace an upper camera scan
+  LOADS_PARAMETER(float, maxPredictionTranslation) /// Odometry translation (mm) after which the complete goal is rescanned
+  LOADS_PARAMETER(float, maxPredictionRotation) /// Odometry rotation (rad) after which the complete goal is rescanned
+  LOADS_PARAMETER(float, maxPredictionHeadMotion) /// Head motion (rad) after which the complete goal is rescanned
+  LOADS_PARAMETER(float, scanWindowMargin) /// Margin (relative to the post size) added to the geometrical scan limits
+  LOADS_PARAMETER(bool, boundedScans) /// Bound the worst case cost of the vertical scans
+  LOADS_PARAMETER(int, maxScanIterations) /// Maximal number of re-centering steps of a vertical scan (bounded mode)
+  LOADS_PARAMETER(int, scanPixelBudget) /// Maximal number of pixels a vertical scan classifies per spot (bounded mode), so at most twice this per spot for the scans down and up
+  LOADS_PARAMETER(bool, flightRecorderDump) /// Dump the flight recorder when the module is destroyed (about 1 MB), otherwise only on the debug request
+  LOADS_PARAMETER(bool, excludeRobotColumns) /// Do not classify or trace the pixels of robots with detected jersey
+  LOADS_PARAMETER(bool, partialRobotExclusion) /// Exclude only the rows of the robot's box instead of the whole columns
+  LOADS_PARAMETER(int, scanThreads) /// Threads (including the cognition thread) that scan the field boundary in strips, read once at construction
+  LOADS_PARAMETER(int, minParallelScanWidth) /// Narrower images are scanned by the cognition thread alone
+  LOADS_PARAMETER(bool, colorTable) /// Classify white by a table that is rebuilt in the background
+  LOADS_PARAMETER(int, colorTableRebuildInterval) /// Time (ms) between two rebuilds of the color table
+  LOADS_PARAMETER(int, colorTableMinHits) /// Confirmed pixels of a color needed to overrule the color reference
+  LOADS_PARAMETER(bool, staticSceneShortCut) /// Skip the scan while neither the robot nor the image changed since the camera's last scan
+  LOADS_PARAMETER(float, maxStaticTranslation) /// Odometry translation (mm) up to which the scene is static
+  LOADS_PARAMETER(float, maxStaticRotation) /// Odometry rotation (rad) up to which the scene is static
+  LOADS_PARAMETER(float, maxStaticCameraRotation) /// Rotation of the camera matrix (rad) up to which the scene is static
+  LOADS_PARAMETER(float, maxStaticCameraTranslation) /// Translation of the camera matrix (mm) up to which the scene is static
+  LOADS_PARAMETER(int, maxStaticPixelDifference) /// Mean difference of the sampled luminances up to which the image is static
+  LOADS_PARAMETER(int, maxStaticFrames) /// Frames of a camera that may be reused before the posts are recomputed
+  LOADS_PARAMETER(bool, baseRefinement) /// Refine the bases of the spots to sub-pixel precision
+  LOADS_PARAMETER(int, baseRefinementWindow) /// Rows above and below the base that are searched for the edge
+  LOADS_PARAMETER(int, minBaseGradient) /// Minimal luminance step of the edge at the base
+  LOADS_PARAMETER(bool, classificationMemo) /// Memoize the white classification of the columns around the candidates for the traces
+  LOADS_PARAMETER(int, maxMemoColumns) /// Maximal number of image columns in the classification memo
+  LOADS_PARAMETER(bool, coarseSearch) /// Scan the field boundary in full resolution only around white coarse samples
+  LOADS_PARAMETER(int, coarseStep) /// Maximal columns between two coarse samples, the step never exceeds the width of the farthest post
+  LOADS_PARAMETER(bool, pairedSearch) /// After a strong post, search its partner only a goal width away
+  LOADS_PARAMETER(float, pairedSearchValidity) /// Validity of a post to search only its partner
+  LOADS_PARAMETER(float, maxGoalSkew) /// Angle (rad) up to which the goal is expected to be seen from the side
+  LOADS_PARAMETER(bool, perfCounters) /// Record hardware counters per stage in the flight recorder (Linux only)
+  LOADS_PARAMETER(bool, fixedResolutions) /// Use the scans compiled for 320x240 and 640x480 if the image has one of these
+  LOADS_PARAMETER(int, postMemoryDuration) /// Time (ms) a seen post positions the posts whose base is cut by the image
+  LOADS_PARAMETER(float, postMemoryMergeDistance) /// Distance (mm) up to which two seen posts are the same post
 END_MODULE
 
 /**
@@ -52,6 +100,11 @@ public:
    */
   GoalPerceptor();
 
+  /**
+   * @brief Destructor, dumps the flight recorder if requested.
+   */
+  ~GoalPerceptor();
+
 private:
   /**
    * @class Spot
@@ -60,7 +113,7 @@ private:
   struct Spot
   {
   public:
-    Spot(int s, int e, int h) : start(s), end(e), validity(100), votePoint(0), leftRight(GoalPost::IS_UNKNOWN)
+    Spot(int s, int e, int h) : start(s), end(e), validity(100), votePoint(0), baseOffset(0), refined(false), leftRight(GoalPost::IS_UNKNOWN), ownScore(0), plausible(false)
     {
       width = end - start;
       mid = Vector2<int>(start+(width / 2), h);
@@ -78,10 +131,42 @@ private:
     std::vector<int> widths; /// Width of the scanned lines
     Vector2<int> mid; /// The middle point in horizontal axie
     Vector2<int> base; /// The lowest point (top-left duo to image coordination) of the spot
+    float baseOffset; /// Sub-pixel offset of the base row, in [-0.5, 0.5]
+    bool refined; /// The base was refined to sub-pixel accuracy, see refineBase
     Vector2<int> top; /// The highest point (bottom-right duo to image coordination) of the spot
     GoalPost::Position leftRight; /// Enumeration to demonstrate whearas the post is right one or left one.
     Vector2<> position; /// Extracted position of the spot in image
     float validity; /// Score the spot has reached by defiend check points
+    float ownScore; /// Sum of the scores of the check points on the spot alone, see scoreSpot
+    bool plausible; /// The spot passed all pass/fail check points on its own
+  };
+
+  /**
+   * @class BoundaryColumn
+   * @brief Result of the scan of one column at the field boundary
+   */
+  struct BoundaryColumn
+  {
+    bool white; /// The pixel at the boundary is white
+    int y; /// Row of the boundary
+    int start; /// Highest row of the white run through the boundary
+    int end; /// Lowest row of the white run, only followed until the minimal candidate height
+  };
+
+  /**
+   * @class StaticScene
+   * @brief What is needed to tell whether the scene of a camera changed since its posts were computed
+   */
+  struct StaticScene
+  {
+    StaticScene() : valid(false), reused(0) {}
+
+    bool valid; /// The posts were computed in a scanned frame of this camera
+    int reused; /// Frames the posts were reused since they were computed
+    std::vector<GoalPost> posts; /// The posts of the scanned frame
+    Pose3D cameraMatrix; /// Camera matrix of the scanned frame
+    Pose2D odometry; /// Odometry accumulated since the scanned frame
+    std::vector<unsigned char> samples; /// Luminances sampled along the field boundary of the scanned frame
   };
 
   // [TODO] : This class should not be here, hence I rather not no doxygen it...
@@ -101,46 +186,128 @@ private:
    */
   void update(GoalPercept& percept);
 
+  /**
+   * @brief Publish the goal of the lower camera, moved by the odometry, if the upper camera was skipped.
+   */
+  void update(PredictedGoalPercept& predictedGoalPercept);
+
+  /**
+   * @brief Add the odometry of this frame and decide whether the goal is scanned, once per frame.
+   * @note Both percepts call it, the framework may update them in either order.
+   */
+  void beginFrame();
+
+  /**
+   * @brief Find the spots along the field boundary and scan them up and down.
+   *        The cheap rejections run as soon as their inputs exist, so the expensive
+   *        scans only see the spots that are left.
+   * @param image: View on the image (see GoalImageView.h)
+   * @param height: clipped horizon
+   */
+  template<typename View> void processSpots(const View& image, const int& height);
+
+  /**
+   * @brief Process the spots with the scans compiled for the dimensions of the image.
+   * @param height: clipped horizon
+   * @return False if there are no scans compiled for the image, nothing was processed then
+   */
+  bool processFixedResolution(const int& height);
+
+  /**
+   * @brief Scan the candidate windows, reject and trace the spots found there.
+   * @param image: View on the image
+   * @param height: clipped horizon
+   */
+  template<typename View> void scanSpots(const View& image, const int& height);
+
+  /**
+   * @brief Scan the widest candidate window first. If it holds a strong post, the rest of the
+   *        image is only scanned where its partner can be, and the sides are assigned directly.
+   * @param image: View on the image
+   * @param height: clipped horizon
+   * @return False if there was no candidate window
+   */
+  template<typename View> bool searchGoalPair(const View& image, const int& height);
+
+  /**
+   * @brief Keep only the candidate windows in which the partner of the given post can be seen.
+   * @param post: a positioned and validated spot
+   */
+  void maskPartnerWindows(const Spot& post);
+
+  /**
+   * @brief Take each candidate through scanning, rejection, positioning and its own scores in
+   *        one pass, then scan the crossbar for all spots that are left.
+   * @param image: View on the image, usually with the classification memo of the candidates
+   * @param height: Scan height
+   */
+  template<typename View> void traceSpots(const View& image, const int& height);
+
+  /**
+   * @brief Put a band of columns around each candidate into the classification memo.
+   */
+  void memoizeSpotColumns();
+
   /**
    * @brief Check the given height for white spots
    * @param height: Scan height
    */
-  void findSpots(const int& height);
+  template<typename View> void findSpots(const View& image, const int& height);
+
+  /**
+   * @brief Scan down to find the lowest white point of the spot.
+   */
+  template<typename View> void verticalColorScanDown(const View& image, Spot& spot);
 
   /**
-   * @brief Scan down to find the lowest white point for each spot.
+   * @brief Scan upward to find the highest white point of the spot.
    */
-  void verticalColorScanDown();
+  template<typename View> void verticalColorScanUp(const View& image, Spot& spot);
 
   /**
-   * @brief Scan upward to find the highest white point for each spot.
+   * @brief Scan once along the tops of all spots for the crossbar and tell left and right posts apart.
    */
-  void verticalColorScanUp();
+  template<typename View> void scanCrossbar(const View& image);
 
   /**
    * @brief Check the pixel in the color table to see if it is white (yellow in the CT).
+   *        Pixels of the body and of excluded robots are not classified and count as not white.
+   * @param image: View on the image
    * @param X, Y: position of the pixel in the image
    * @return True if the color is white
    */
-  bool isWhite(const int& x, const int& y);
+  template<typename View> bool isWhite(const View& image, const int& x, const int& y);
+
+  /**
+   * @brief Classify the pixel by the color table, or by the color reference while there is no table.
+   * @param image: View on the image
+   * @param x, y: position of the pixel in the image
+   */
+  template<typename View> bool isWhiteColor(const View& image, int x, int y) const;
+  template<typename View> bool isWhiteColor(const GoalImageView::Memoized<View>& image, int x, int y) const;
 
   /**
    * @brief Track the gradient of the pixels
+   * @param image: View on the image
    * @param x, y: position of the pixel in the image
    * @param Y, Cr, Cb: color of the previous pixel (or any other pixel) that needs to be track
    * @return True if the difference is not quite much
    * @note The difference is in goal perceptor configuration file as 'color difference value'
    */
-  bool isInGrad(int x, int y, unsigned char& Y, unsigned char& Cr, unsigned char& Cb);
+  template<typename View> bool isInGrad(const View& image, int x, int y, unsigned char& Y, unsigned char& Cr, unsigned char& Cb);
 
   /**
    * @brief Calculate the projected position of the goal post on the field.
    */
-  void calculatePosition(const int& height);
+  void calculatePosition(Spot& spot, const int& height);
 
+  /**
+   * @brief Rate the spot by the qualifiers that do not depend on the other spots.
+   */
+  void scoreSpot(Spot& spot);
 
   /**
-   * @brief Validate the spots and rate them by for defined qualifiers.
+   * @brief Validate the scored spots against each other and sort them by validity.
    */
   void validate();
 
@@ -151,9 +318,65 @@ private:
 
 
   /**
-   * @brief Remove the goal-posts that does not satisfy the defined check-list.
+   * @brief Sample the luminance along the field boundary (into boundarySamples)
+   */
+  void sampleBoundary();
+
+  /**
+   * @brief Decide whether the scene of the camera is the same as when its posts were computed.
+   * @return True if the posts of the camera can be reused
+   */
+  bool isSceneStatic();
+
+  /**
+   * @brief Draw the posts of the camera's last scanned frame, which are still where they were.
+   * @note They are not published again, the self-locator would count them as new sightings.
+   */
+  void drawStaticScene();
+
+  /**
+   * @brief Remember the posts and the state of the scanned frame for the static scene short-cut.
+   * @param percept: The percept of the scanned frame
+   */
+  void storeStaticScene(const GoalPercept& percept);
+
+  /**
+   * @brief Take the color table finished in the background and request the next one when it is due.
+   */
+  void updateColorTable();
+
+  /**
+   * @brief Add the pixels of a complete goal to be posted (and the green below it) to the color statistics.
+   */
+  void collectColorStatistics();
+
+  /**
+   * @brief Rasterize the body contour into the highest row of the robot's body per column.
+   */
+  void rasterizeBodyContour();
+
+  /**
+   * @brief Turn the robots with detected jersey into the per column exclusion mask.
    */
-  void removeNotGoalposts();
+  void maskRobotColumns();
+
+  /**
+   * @brief Check the exclusion mask of the robots
+   * @param x, y: position of the pixel in the image
+   * @return True if the pixel belongs to a robot and should not be classified
+   */
+  bool isRobotExcluded(int x, int y) const;
+
+  /**
+   * @brief Check whether the base of the spot is hidden by the robot's own body.
+   */
+  bool isBaseHidden(const Spot& spot);
+
+  /**
+   * @brief Remove the spots that duplicate a later spot at the same column.
+   * @note The spots are sorted by validity when this is called, so the better duplicate is kept.
+   */
+  void removeDuplicates();
 
   /**
    * @brief Gives the height of the convex boundary of the given x
@@ -163,16 +386,62 @@ private:
    */
   int boundaryStepGenerator(int x);
 
+  /**
+   * @brief Gives the highest image row the top of a goal post with the given base can reach
+   * @param base : base of the post in the image
+   * @return the row including the margin, or 0 if the base is not on the field
+   */
+  int postTopLimit(const Vector2<int>& base);
+
+  /**
+   * @brief Gives the lowest image row the base of the given spot can reach
+   * @param spot : the spot whose width bounds the distance of the post
+   * @return the row including the margin, clipped to the image
+   */
+  int postBaseLimit(const Spot& spot);
+
+  /**
+   * @brief Maximal number of re-centering steps of one vertical scan of a spot
+   */
+  int iterationLimit() const;
+
+  /**
+   * @brief Number of pixels one vertical scan may classify for a spot
+   */
+  int pixelBudget() const;
+
+  /**
+   * @brief Remember that a scan of the given spot was cut by the bounded mode.
+   */
+  void reportScanLimit(const Spot& spot);
+
   /**
    * @brief Scans the field boundary for any white pixel violation
+   * @param image : View on the image
+   * @param height : clipped horizon
+   */
+  template<typename View> void scanFieldBoundarySpots(const View& image, const int& height);
+
+  /**
+   * @brief Scan a range of columns at the field boundary, called from the strip workers
+   * @param image : View on the image
    * @param height : clipped horizon
+   * @param first, last : range of the columns (every second image column) to be scanned
+   */
+  template<typename View> void scanBoundaryColumns(const View& image, const int& height, int first, int last);
+
+  /**
+   * @brief Sample the field boundary coarsely and mark the columns around white samples for the full scan
+   * @param image : View on the image
+   * @param numOfColumns : number of columns of the full scan (every second image column)
+   * @param coarse : Sample coarsely, otherwise all columns are marked
    */
-  void scanFieldBoundarySpots(const int& height);
+  template<typename View> void markCandidateWindows(const View& image, int numOfColumns, bool coarse);
 
   /**
-   * @brief Clip the boundary of goal-posts to their candidate limitations
+   * @brief Clip the boundary of the goal-post to its candidate limitations
    */
-  void clipSpotBoundaries();
+  void clipSpotBoundaries(Spot& spot);
 
   /**
    * @brief Reject spots inside the detected obstacle with jersey
@@ -180,18 +449,61 @@ private:
   void rejectRobot();
 
   /**
-   * @brief Remove the spots with low vote point
+   * @brief Check whether the spot has a low vote point
+   */
+  bool hasLowVotePoint(const Spot& spot);
+
+  /**
+   * @brief Refine the base of the spot to sub-pixel precision at the strongest luminance
+   *        edge in a short window around it. The cost is fixed by the window.
+   * @param image: View on the image
    */
-  void calculateVotePoints();
+  template<typename View> void refineBase(const View& image, Spot& spot);
 
   /**
-   * @brief Percise the lower boundary of the goal posts
+   * @brief Write the flight recorder to Config/goalFlightRecorder.log
    */
-  void bottomCorrector();
+  void dumpFlightRecorder();
+
+  /**
+   * @brief Decide whether the goal must be scanned in the current camera frame.
+   * @return False if the complete goal of the lower camera is still fresh enough to be predicted
+   */
+  bool goalPerceptionRequired();
+
+  /**
+   * @brief Draw where the last complete goal of the lower camera is expected in this image.
+   * @note The prediction is not part of the GoalPercept, the self-locator would count it as a
+   *       new sighting. It is published in the PredictedGoalPercept.
+   */
+  void drawPredictedGoal();
 
   Spot candidateSpot;  /// Candidate Iterator on spots
   std::list<Spot> spots; /// Set of candidate spots to be goal post
-  std::vector<Spot> lastPosts; /// Goal posts from last farme
   bool RobotRejection; /// Flag to use robot rejection sub-module
+  bool scanLimitHit; /// A vertical scan was cut by the bounded mode in this frame, only the flight recorder and the plot show it (not the GoalPercept)
+  GoalFlightRecorder flightRecorder; /// Statistics of the recent frames
+  bool perfCountersRequested; /// The flight recorder was asked to enable the hardware counters
+  std::vector<int> bodyContourTop; /// Per column, the highest row that shows the robot's own body
+  std::vector<int> robotMaskTop; /// Per column, the first row excluded for robots
+  std::vector<int> robotMaskBottom; /// Per column, the last row excluded for robots (-1 if none)
+  std::vector<BoundaryColumn> boundaryColumns; /// Scan results of every second column at the field boundary
+  std::vector<bool> candidateWindows; /// Per column of the full scan, whether it is near a white coarse sample
+  GoalStripWorkers stripWorkers; /// Threads that scan the strips of the field boundary
+  GoalImageView::ClassificationMemo spotMemo; /// Classified columns around the candidates
+  std::unique_ptr<GoalColorTable> whiteTable; /// The color table in use, none until the first one is built
+  GoalColorTableBuilder colorTableBuilder; /// Builds the color tables in the background
+  GoalColorStatistics colorStatistics; /// Colors of the confirmed posts since the last request
+  unsigned timeWhenColorTableRequested; /// Frame time of the last request of a color table
+  StaticScene staticScenes[CameraInfo::numOfCameras]; /// The last scanned frame of each camera
+  std::vector<unsigned char> boundarySamples; /// Luminances sampled along the field boundary of the current frame
+  GoalPostMemory postMemory; /// Posts seen by both cameras in the recent past
+
+  std::vector<GoalPost> completeGoal; /// The last complete goal seen by the lower camera
+  unsigned timeWhenCompleteGoalMeasured; /// Frame time of the complete goal
+  unsigned timeOfCurrentFrame; /// Frame time of the last call of beginFrame
+  bool goalScanSkipped; /// The goal is predicted instead of scanned in the current frame
+  Pose2D odometrySinceCompleteGoal; /// Odometry accumulated since the complete goal was seen
+  Vector2<> headAnglesOfCompleteGoal; /// Head yaw and pitch when the complete goal was seen
 };
 
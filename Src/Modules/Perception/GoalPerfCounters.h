@@ -0,0 +1,121 @@
+/**
+ * @file GoalPerfCounters.h
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+#pragma once
+
+#ifdef LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+/**
+ * @class GoalPerfCounters
+ * @brief Hardware performance counters of the calling thread, read as one group.
+ *
+ * The counters are only available on Linux and only if the kernel permits them
+ * (see /proc/sys/kernel/perf_event_paranoid). Otherwise open() fails and the
+ * benchmarks fall back to timing only.
+ */
+class GoalPerfCounters
+{
+public:
+  enum Counter
+  {
+    cycles,
+    instructions,
+    cacheMisses,
+    branchMisses,
+    numOfCounters
+  };
+
+  GoalPerfCounters()
+  {
+    for(int i = 0; i < numOfCounters; ++i)
+      fds[i] = -1;
+  }
+
+  ~GoalPerfCounters() { close(); }
+
+  bool isOpen() const { return fds[0] >= 0; }
+
+  /**
+   * @brief Open and start the counters for the calling thread.
+   * @return False if the counters are not available or not permitted
+   */
+  bool open()
+  {
+#ifdef LINUX
+    if(isOpen())
+      return true;
+
+    static const unsigned long long configs[numOfCounters] =
+    {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for(int i = 0; i < numOfCounters; ++i)
+    {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.disabled = i == 0; // the group starts with its leader
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, i ? fds[0] : -1, 0);
+      if(fds[i] < 0)
+      {
+        close();
+        return false;
+      }
+    }
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void close()
+  {
+#ifdef LINUX
+    for(int i = numOfCounters - 1; i >= 0; --i)
+      if(fds[i] >= 0)
+        ::close(fds[i]);
+#endif
+    for(int i = 0; i < numOfCounters; ++i)
+      fds[i] = -1;
+  }
+
+  /**
+   * @brief Read the current values of all counters.
+   * @return False if the counters are not open or could not be read
+   */
+  bool read(unsigned long long values[numOfCounters]) const
+  {
+#ifdef LINUX
+    struct
+    {
+      unsigned long long nr;
+      unsigned long long values[numOfCounters];
+    } data;
+    if(!isOpen() || ::read(fds[0], &data, sizeof(data)) != (ssize_t)sizeof(data) || data.nr != numOfCounters)
+      return false;
+    for(int i = 0; i < numOfCounters; ++i)
+      values[i] = data.values[i];
+    return true;
+#else
+    (void)values;
+    return false;
+#endif
+  }
+
+private:
+  int fds[numOfCounters]; /// The group leader (cycles) first
+};
@@ -0,0 +1,140 @@
+/**
+ * @file GoalPostMemory.h
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+#pragma once
+
+#include "Tools/Math/Geometry.h"
+#include "Tools/Math/Pose2D.h"
+#include "Representations/Perception/CameraMatrix.h"
+#include "Representations/Infrastructure/CameraInfo.h"
+#include <algorithm>
+#include <vector>
+
+/**
+ * @class GoalPostMemory
+ * @brief The goal posts seen by both cameras in the recent past, in the frame of the odometry.
+ *
+ * The posts are stored relative to where the robot was when the memory was started, so
+ * moving the robot only updates one pose. Observations of the same post are merged. Once
+ * per frame the posts are projected into the image and sorted by their column, so a spot
+ * finds the posts in its columns by a binary search.
+ */
+class GoalPostMemory
+{
+public:
+  /**
+   * @brief A post of the memory, projected into the current image.
+   */
+  struct Prior
+  {
+    Vector2<int> inImage; /// Base of the post in the image
+    Vector2<> position; /// Position of the post relative to the robot
+    int observations; /// Number of observations merged into the post
+  };
+
+  /**
+   * @brief Move the robot within the memory.
+   */
+  void move(const Pose2D& odometryOffset) { robot += odometryOffset; }
+
+  /**
+   * @brief Drop the posts that were not seen for the given time.
+   * @param now: Frame time
+   * @param maxAge: Time (ms) a post is kept after it was seen the last time
+   */
+  void forget(unsigned now, int maxAge)
+  {
+    posts.erase(std::remove_if(posts.begin(), posts.end(), [&](const Post& p) { return (int)(now - p.time) > maxAge; }), posts.end());
+    if (posts.empty())
+      robot = Pose2D(); //-- Start over, so the pose does not grow with the walked distance
+  }
+
+  /**
+   * @brief Add an observation, it is merged into the closest post if that is near enough.
+   * @param position: Position of the post relative to the robot
+   * @param time: Frame time of the observation
+   * @param mergeDistance: Distance (mm) up to which two observations are the same post
+   */
+  void add(const Vector2<>& position, unsigned time, float mergeDistance)
+  {
+    const Vector2<> inMemory = robot * position;
+    Post* closest = nullptr;
+    float closestDistance = mergeDistance;
+    for (Post& p : posts)
+    {
+      const float distance = (p.position - inMemory).abs();
+      if (distance <= closestDistance)
+      {
+        closest = &p;
+        closestDistance = distance;
+      }
+    }
+
+    if (closest)
+    {
+      //-- Running average, its weight is capped so the post follows the drift of the odometry
+      closest->position = (closest->position * (float)closest->observations + inMemory) / (float)(closest->observations + 1);
+      if (closest->observations < maxObservations)
+        closest->observations++;
+      closest->time = time;
+      return;
+    }
+
+    if (posts.size() >= maxPosts)
+      posts.erase(std::min_element(posts.begin(), posts.end(), [](const Post& a, const Post& b) { return a.time < b.time; }));
+    Post p;
+    p.position = inMemory;
+    p.time = time;
+    p.observations = 1;
+    posts.push_back(p);
+  }
+
+  /**
+   * @brief Project the posts into the current image, sorted by column.
+   */
+  void project(const CameraMatrix& cameraMatrix, const CameraInfo& cameraInfo)
+  {
+    priors.clear();
+    Pose2D inverseRobot = robot;
+    inverseRobot.invert();
+    for (const Post& p : posts)
+    {
+      Prior prior;
+      prior.position = inverseRobot * p.position;
+      prior.observations = p.observations;
+      if (!Geometry::calculatePointInImage(prior.position, cameraMatrix, cameraInfo, prior.inImage))
+        continue;
+      priors.push_back(prior);
+    }
+    std::sort(priors.begin(), priors.end(), [](const Prior& a, const Prior& b) { return a.inImage.x < b.inImage.x; });
+  }
+
+  /**
+   * @brief The projected posts, sorted by column.
+   */
+  const std::vector<Prior>& getPriors() const { return priors; }
+
+  /**
+   * @brief The first projected post right of the given column.
+   */
+  std::vector<Prior>::const_iterator firstRightOf(int x) const
+  {
+    return std::upper_bound(priors.begin(), priors.end(), x, [](int column, const Prior& p) { return column < p.inImage.x; });
+  }
+
+private:
+  struct Post
+  {
+    Vector2<> position; /// Position in the frame of the memory
+    unsigned time; /// Frame time of the last observation
+    int observations; /// Number of merged observations
+  };
+
+  static const size_t maxPosts = 8; /// The oldest post is replaced when the memory is full
+  static const int maxObservations = 16; /// Older observations fade out of the average beyond this
+
+  Pose2D robot; /// The robot in the frame of the memory
+  std::vector<Post> posts;
+  std::vector<Prior> priors; /// The posts projected into the current image
+};
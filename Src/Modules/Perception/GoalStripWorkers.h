@@ -0,0 +1,141 @@
+/**
+ * @file GoalStripWorkers.h
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class GoalStripWorkers
+ * @brief Persistent threads that process the vertical strips of an image together with the caller.
+ *
+ * The threads are created once with the pool and wait for jobs, so a frame only pays
+ * for waking them up. The caller takes part in the job and run() returns after every
+ * strip is done and every worker has seen the job, so the job may live on the caller's
+ * stack. A job of a single strip is run by the caller alone.
+ */
+class GoalStripWorkers
+{
+public:
+  typedef std::function<void(unsigned strip)> Job;
+
+  /**
+   * @param count: Number of threads that process the strips, including the caller of run()
+   */
+  explicit GoalStripWorkers(unsigned count) :
+    job(nullptr), numOfStrips(0), finishedStrips(0), acknowledged(0), generation(0), stopping(false), nextStrip(0)
+  {
+    for(unsigned i = 1; i < count; ++i)
+      threads.push_back(std::thread(&GoalStripWorkers::work, this));
+
+    //-- Every worker has to wait for the first job before one is published, or it would miss it
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return acknowledged == threads.size(); });
+  }
+
+  ~GoalStripWorkers()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wakeUp.notify_all();
+    for(std::thread& thread : threads)
+      thread.join();
+  }
+
+  /**
+   * @brief Number of threads that process the strips, including the caller of run().
+   */
+  unsigned numOfThreads() const { return (unsigned)threads.size() + 1; }
+
+  /**
+   * @brief Call the job once for each strip and wait until all strips are done.
+   */
+  void run(unsigned strips, const Job& job)
+  {
+    if(threads.empty() || strips <= 1)
+    {
+      for(unsigned s = 0; s < strips; ++s)
+        job(s);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      this->job = &job;
+      numOfStrips = strips;
+      finishedStrips = 0;
+      acknowledged = 0;
+      nextStrip = 0;
+      ++generation;
+    }
+    wakeUp.notify_all();
+
+    process(job, strips);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return finishedStrips == numOfStrips && acknowledged == threads.size(); });
+    this->job = nullptr;
+  }
+
+private:
+  /**
+   * @brief Take strips of the current job until there are none left.
+   */
+  void process(const Job& job, unsigned strips)
+  {
+    for(unsigned s = nextStrip.fetch_add(1); s < strips; s = nextStrip.fetch_add(1))
+    {
+      job(s);
+      std::lock_guard<std::mutex> lock(mutex);
+      ++finishedStrips;
+    }
+  }
+
+  /**
+   * @brief Main loop of a worker: each job is taken exactly once.
+   */
+  void work()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    unsigned seen = generation;
+    ++acknowledged;
+    done.notify_one();
+    for(;;)
+    {
+      wakeUp.wait(lock, [&] { return stopping || generation != seen; });
+      if(stopping)
+        return;
+      seen = generation;
+      const Job& current = *job;
+      const unsigned strips = numOfStrips;
+
+      lock.unlock();
+      process(current, strips);
+      lock.lock();
+
+      ++acknowledged;
+      done.notify_one();
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::mutex mutex; /// Guards everything below except nextStrip
+  std::condition_variable wakeUp; /// A job was published or the workers are stopped
+  std::condition_variable done; /// A worker finished its part of the job
+  const Job* job; /// The current job
+  unsigned numOfStrips; /// Strips of the current job
+  unsigned finishedStrips; /// Strips of the current job that are done
+  size_t acknowledged; /// Workers that are done with the current job
+  unsigned generation; /// Number of the current job
+  bool stopping; /// The workers have to return
+  std::atomic<unsigned> nextStrip; /// Next strip to be taken
+};
@@ -0,0 +1,13 @@
+/**
+ * @file GroundTruthGoalPercept.h
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+#pragma once
+
+#include "GoalPercept.h"
+
+/**
+ * @class GroundTruthGoalPercept
+ * @brief The goal posts of a synthetic scene, exactly as they are rendered into the image.
+ */
+class GroundTruthGoalPercept : public GoalPercept {};
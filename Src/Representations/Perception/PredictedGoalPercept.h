@@ -0,0 +1,17 @@
+/**
+ * @file PredictedGoalPercept.h
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+#pragma once
+
+#include "GoalPercept.h"
+
+/**
+ * @class PredictedGoalPercept
+ * @brief The goal posts expected in a frame of the upper camera whose goal scan was skipped.
+ *
+ * They are the posts of the last complete goal of the lower camera, moved by the odometry
+ * since then. The times are those of that measurement, so a prediction is never a new
+ * observation. It is empty in every frame that was scanned.
+ */
+class PredictedGoalPercept : public GoalPercept {};
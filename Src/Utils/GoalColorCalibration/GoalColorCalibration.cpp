@@ -0,0 +1,469 @@
+/**
+ * @file GoalColorCalibration.cpp
+ *
+ * Searches the yellow (the goal posts' white) and green ranges of colorProvider.cfg on
+ * labeled frames, on all cores, and writes the best ones into a copy of the file. It does
+ * not depend on the framework:
+ *
+ *   g++ -std=c++11 -O2 -pthread -o goalColorCalibration GoalColorCalibration.cpp
+ *   ./goalColorCalibration labels.txt colorProvider.cfg calibrated.cfg [restarts]
+ *
+ * The label file names the frames and the rectangles (left top right bottom, inclusive)
+ * of the regions in each frame. A frame is the raw buffer of the Image, 4 bytes (a YUYV
+ * pair) per pixel, so the coordinates are those of the GoalPerceptor's drawings:
+ *
+ *   frame upper_0001.yuv 320 240
+ *   post 106 40 115 150
+ *   green 90 155 150 180
+ *   background 0 20 319 45
+ *
+ * The bottom of a post rectangle is its base. A candidate is scored the way the
+ * GoalPerceptor would use it: the post pixels have to be yellow, the green and background
+ * pixels must not, the scan down the middle of each post has to stop at the labeled base
+ * and the vote point below the base has to be reached.
+ *
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const float pi2 = 6.2831853f;
+
+/**
+ * A pixel in the color space of the ranges: hue in [0, 2pi), saturation and value in [0, 1].
+ */
+struct HSV
+{
+  float h, s, v;
+};
+
+/**
+ * Same conversion as the color reference: YCbCr to RGB (ITU-R BT.601), then to HSV.
+ */
+static HSV toHSV(unsigned char y, unsigned char cb, unsigned char cr)
+{
+  const float r = std::max(0.f, std::min(255.f, y + 1.402f * (cr - 128)));
+  const float g = std::max(0.f, std::min(255.f, y - 0.344f * (cb - 128) - 0.714f * (cr - 128)));
+  const float b = std::max(0.f, std::min(255.f, y + 1.772f * (cb - 128)));
+  const float max = std::max(r, std::max(g, b));
+  const float min = std::min(r, std::min(g, b));
+  const float delta = max - min;
+
+  HSV hsv;
+  hsv.v = max / 255.f;
+  hsv.s = max > 0.f ? delta / max : 0.f;
+  if(delta <= 0.f)
+    hsv.h = 0.f;
+  else if(max == r)
+    hsv.h = (g - b) / delta;
+  else if(max == g)
+    hsv.h = 2.f + (b - r) / delta;
+  else
+    hsv.h = 4.f + (r - g) / delta;
+  hsv.h *= pi2 / 6.f;
+  if(hsv.h < 0.f)
+    hsv.h += pi2;
+  return hsv;
+}
+
+/**
+ * The ranges of one color, the hue range wraps around if min is greater than max.
+ */
+struct Range
+{
+  enum {minH, maxH, minS, maxS, minV, maxV, numOfValues};
+  float values[numOfValues];
+
+  bool contains(const HSV& p) const
+  {
+    const bool hue = values[minH] <= values[maxH] ? p.h >= values[minH] && p.h <= values[maxH] : p.h >= values[minH] || p.h <= values[maxH];
+    return hue && p.s >= values[minS] && p.s <= values[maxS] && p.v >= values[minV] && p.v <= values[maxV];
+  }
+};
+
+/**
+ * The searched parameters: yellow first, then green, in the order of the keys below.
+ */
+struct Candidate
+{
+  Range yellow, green;
+  float& operator[](int i) { return i < Range::numOfValues ? yellow.values[i] : green.values[i - Range::numOfValues]; }
+};
+static const int numOfParameters = 2 * Range::numOfValues;
+static const char* keys[numOfParameters] =
+{
+  "minHYellow", "maxHYellow", "minSYellow", "maxSYellow", "minVYellow", "maxVYellow",
+  "minHGreen", "maxHGreen", "minSGreen", "maxSGreen", "minVGreen", "maxVGreen"
+};
+
+/**
+ * A labeled post: the pixels of its middle column from half its height down to below the base.
+ */
+struct Post
+{
+  std::vector<HSV> column;
+  int base; /// Index of the labeled base in column
+};
+
+/**
+ * The samples of all frames, converted once.
+ */
+struct Samples
+{
+  std::vector<HSV> post, green, background;
+  std::vector<Post> posts;
+};
+
+struct Settings
+{
+  int minVotePoint; /// Same as in goalPerceptor.cfg
+  int maxBaseError; /// Rows a found base may be away from the labeled one
+  unsigned maxSamplesPerRegion; /// Regions are subsampled down to this
+};
+
+/**
+ * Sample every pixel of a rectangle, or a regular subset of a large one.
+ */
+static void sampleRegion(const std::vector<unsigned char>& image, int width, int height, int left, int top, int right, int bottom,
+                         unsigned maxSamples, std::vector<HSV>& samples)
+{
+  left = std::max(0, left);
+  top = std::max(0, top);
+  right = std::min(width - 1, right);
+  bottom = std::min(height - 1, bottom);
+  if(left > right || top > bottom)
+    return;
+  const unsigned area = (unsigned)((right - left + 1) * (bottom - top + 1));
+  const int step = std::max(1, (int)std::sqrt((float)area / maxSamples));
+  for(int y = top; y <= bottom; y += step)
+    for(int x = left; x <= right; x += step)
+    {
+      const unsigned char* pixel = &image[(y * width + x) * 4];
+      samples.push_back(toHSV(pixel[2], pixel[1], pixel[3]));
+    }
+}
+
+/**
+ * Read the label file and the frames it names.
+ */
+static bool readLabels(const char* path, const Settings& settings, Samples& samples)
+{
+  std::ifstream in(path);
+  if(!in)
+  {
+    std::fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+
+  //-- Frames are named relative to the label file
+  std::string directory(path);
+  const size_t slash = directory.find_last_of('/');
+  directory = slash == std::string::npos ? std::string() : directory.substr(0, slash + 1);
+
+  std::vector<unsigned char> image;
+  int width = 0, height = 0, frames = 0;
+  std::string line;
+  for(int lineNumber = 1; std::getline(in, line); ++lineNumber)
+  {
+    std::istringstream stream(line);
+    std::string type;
+    if(!(stream >> type) || type[0] == '#')
+      continue;
+
+    if(type == "frame")
+    {
+      std::string name;
+      if(!(stream >> name >> width >> height) || width <= 0 || height <= 0)
+      {
+        std::fprintf(stderr, "%s:%d: expected 'frame <file> <width> <height>'\n", path, lineNumber);
+        return false;
+      }
+      std::FILE* frame = std::fopen((name[0] == '/' ? name : directory + name).c_str(), "rb");
+      image.resize(width * height * 4);
+      if(!frame || std::fread(&image[0], image.size(), 1, frame) != 1)
+      {
+        std::fprintf(stderr, "%s:%d: cannot read %s\n", path, lineNumber, name.c_str());
+        if(frame)
+          std::fclose(frame);
+        return false;
+      }
+      std::fclose(frame);
+      ++frames;
+      continue;
+    }
+
+    int left, top, right, bottom;
+    if(!(stream >> left >> top >> right >> bottom) || image.empty())
+    {
+      std::fprintf(stderr, "%s:%d: expected '%s <left> <top> <right> <bottom>' after a frame\n", path, lineNumber, type.c_str());
+      return false;
+    }
+    if(type == "post")
+    {
+      sampleRegion(image, width, height, left, top, right, bottom, settings.maxSamplesPerRegion, samples.post);
+
+      //-- The scan starts in the middle of the post and may pass the base by the vote point samples
+      Post post;
+      const int x = std::max(0, std::min(width - 1, (left + right) / 2));
+      const int first = std::max(0, (top + bottom) / 2);
+      const int last = std::min(height - 1, bottom + settings.maxBaseError + 15);
+      for(int y = first; y <= last; ++y)
+      {
+        const unsigned char* pixel = &image[(y * width + x) * 4];
+        post.column.push_back(toHSV(pixel[2], pixel[1], pixel[3]));
+      }
+      post.base = bottom - first;
+      if(post.base > 0 && !post.column.empty())
+        samples.posts.push_back(post);
+    }
+    else if(type == "green")
+      sampleRegion(image, width, height, left, top, right, bottom, settings.maxSamplesPerRegion, samples.green);
+    else if(type == "background")
+      sampleRegion(image, width, height, left, top, right, bottom, settings.maxSamplesPerRegion, samples.background);
+    else
+    {
+      std::fprintf(stderr, "%s:%d: unknown region '%s'\n", path, lineNumber, type.c_str());
+      return false;
+    }
+  }
+  std::printf("%d frames, %u posts, %u post, %u green and %u background samples\n", frames, (unsigned)samples.posts.size(),
+              (unsigned)samples.post.size(), (unsigned)samples.green.size(), (unsigned)samples.background.size());
+  return !samples.posts.empty() && !samples.green.empty();
+}
+
+static float share(const std::vector<HSV>& samples, const Range& range)
+{
+  if(samples.empty())
+    return 0.f;
+  unsigned hits = 0;
+  for(const HSV& p : samples)
+    hits += range.contains(p) ? 1 : 0;
+  return (float)hits / samples.size();
+}
+
+/**
+ * Score of a candidate, higher is better. Detected posts count most, the pixel
+ * classification breaks the ties and the base error refines the placement.
+ */
+static float score(const Candidate& c, const Samples& samples, const Settings& settings)
+{
+  float detected = 0.f, baseError = 0.f;
+  for(const Post& post : samples.posts)
+  {
+    //-- The scan down of verticalColorScanDown, it tolerates a gap of a single pixel
+    const int size = (int)post.column.size();
+    int noGaps = 2, base = size - 1;
+    for(int y = 0; y < size; ++y)
+    {
+      if(c.yellow.contains(post.column[y]))
+        ++noGaps;
+      else if(noGaps > 1)
+        noGaps = 0;
+      else
+      {
+        base = std::max(0, y - 2);
+        break;
+      }
+    }
+
+    //-- The vote point of the GoalPerceptor, 5 samples below the base
+    int total = 0, positive = 0;
+    for(int v = 0; v < 15 && base + v < size; v += 3, ++total)
+      positive += c.green.contains(post.column[base + v]) ? 100 : 0;
+
+    const int error = std::abs(base + 1 - post.base);
+    baseError += (float)std::min(error, settings.maxBaseError * 4);
+    if(total && positive / total >= settings.minVotePoint && error <= settings.maxBaseError)
+      detected += 1.f;
+  }
+  detected /= samples.posts.size();
+  baseError /= samples.posts.size();
+
+  const float yellow = share(samples.post, c.yellow) - 0.5f * (share(samples.green, c.yellow) + share(samples.background, c.yellow));
+  const float green = share(samples.green, c.green) - 0.5f * (share(samples.post, c.green) + share(samples.background, c.green));
+  return detected * 100.f + (yellow + green) * 25.f - baseError;
+}
+
+/**
+ * Keep a parameter in its domain, hues wrap around.
+ */
+static void clip(Candidate& c, int i)
+{
+  float& value = c[i];
+  if(i % Range::numOfValues < 2)
+    value = std::fmod(std::fmod(value, pi2) + pi2, pi2);
+  else
+    value = std::max(0.f, std::min(1.f, value));
+}
+
+/**
+ * Coordinate descent from a start, the steps are halved until they are small.
+ */
+static float descend(Candidate& c, const Samples& samples, const Settings& settings)
+{
+  float best = score(c, samples, settings);
+  float steps[numOfParameters];
+  for(int i = 0; i < numOfParameters; ++i)
+    steps[i] = i % Range::numOfValues < 2 ? 0.4f : 0.1f;
+
+  for(bool moving = true; moving;)
+  {
+    moving = false;
+    for(int i = 0; i < numOfParameters; ++i)
+    {
+      if(steps[i] < 0.005f)
+        continue;
+      moving = true;
+      bool improved = false;
+      for(int direction = -1; direction <= 1 && !improved; direction += 2)
+      {
+        Candidate next = c;
+        next[i] += direction * steps[i];
+        clip(next, i);
+        const float value = score(next, samples, settings);
+        if(value > best)
+        {
+          best = value;
+          c = next;
+          improved = true;
+        }
+      }
+      if(!improved)
+        steps[i] *= 0.5f;
+    }
+  }
+  return best;
+}
+
+/**
+ * Read 'key = value;' lines, the other lines are kept as they are.
+ */
+static bool readConfig(const char* path, std::vector<std::string>& lines, Candidate& c)
+{
+  std::ifstream in(path);
+  if(!in)
+  {
+    std::fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  int found = 0;
+  for(std::string line; std::getline(in, line);)
+  {
+    lines.push_back(line);
+    for(int i = 0; i < numOfParameters; ++i)
+    {
+      const size_t length = std::strlen(keys[i]);
+      const size_t equals = line.find('=');
+      if(line.compare(0, length, keys[i]) == 0 && equals != std::string::npos && line.find_first_not_of(' ', length) == equals)
+      {
+        c[i] = (float)std::atof(line.c_str() + equals + 1);
+        ++found;
+      }
+    }
+  }
+  if(found != numOfParameters)
+  {
+    std::fprintf(stderr, "%s does not contain all yellow and green ranges\n", path);
+    return false;
+  }
+  return true;
+}
+
+static bool writeConfig(const char* path, const std::vector<std::string>& lines, Candidate& c)
+{
+  std::FILE* out = std::fopen(path, "w");
+  if(!out)
+  {
+    std::fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  for(const std::string& line : lines)
+  {
+    int key = -1;
+    for(int i = 0; i < numOfParameters && key < 0; ++i)
+      if(line.compare(0, std::strlen(keys[i]), keys[i]) == 0 && line.find_first_not_of(' ', std::strlen(keys[i])) == line.find('='))
+        key = i;
+    if(key < 0)
+      std::fprintf(out, "%s\n", line.c_str());
+    else
+      std::fprintf(out, "%s = %.2f;\n", keys[key], c[key]);
+  }
+  std::fclose(out);
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 4)
+  {
+    std::fprintf(stderr, "usage: %s <labels.txt> <colorProvider.cfg> <calibrated.cfg> [restarts]\n", argv[0]);
+    return 1;
+  }
+
+  Settings settings;
+  settings.minVotePoint = 30;
+  settings.maxBaseError = 3;
+  settings.maxSamplesPerRegion = 2000;
+
+  Samples samples;
+  std::vector<std::string> lines;
+  Candidate initial;
+  if(!readConfig(argv[2], lines, initial) || !readLabels(argv[1], settings, samples))
+    return 1;
+  const int restarts = argc > 4 ? std::max(1, std::atoi(argv[4])) : 64;
+
+  //-- The restarts are independent, every core takes the next one until none is left
+  std::atomic<int> nextRestart(0);
+  std::mutex mutex;
+  Candidate best = initial;
+  const float initialScore = score(initial, samples, settings);
+  float bestScore = initialScore;
+  auto work = [&]
+  {
+    for(int r = nextRestart++; r < restarts; r = nextRestart++)
+    {
+      //-- The first restart starts from the given ranges, the others around them
+      Candidate c = initial;
+      std::mt19937 random((unsigned)r);
+      for(int i = 0; i < numOfParameters && r; ++i)
+      {
+        const float spread = i % Range::numOfValues < 2 ? 1.f : 0.25f;
+        c[i] += std::uniform_real_distribution<float>(-spread, spread)(random);
+        clip(c, i);
+      }
+      const float value = descend(c, samples, settings);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if(value > bestScore)
+      {
+        bestScore = value;
+        best = c;
+      }
+    }
+  };
+
+  const unsigned numOfThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> threads;
+  for(unsigned t = 1; t < numOfThreads; ++t)
+    threads.push_back(std::thread(work));
+  work();
+  for(std::thread& thread : threads)
+    thread.join();
+
+  std::printf("%d restarts on %u threads, score %.1f -> %.1f\n", restarts, numOfThreads, initialScore, bestScore);
+  for(int i = 0; i < numOfParameters; ++i)
+    std::printf("%-12s %6.2f -> %6.2f\n", keys[i], initial[i], best[i]);
+  return writeConfig(argv[3], lines, best) ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file GoalFlightReport.cpp
+ *
+ * Turns a dump of the GoalPerceptor's flight recorder (Config/goalFlightRecorder.log)
+ * into a per-frame timeline (CSV) and histograms of the stage durations and
+ * candidate counts, and the hardware counters per stage if they were recorded. It does
+ * not depend on the framework:
+ *
+ *   g++ -std=c++11 -O2 -o goalFlightReport GoalFlightReport.cpp
+ *   ./goalFlightReport goalFlightRecorder.log timeline.csv
+ *
+ * @author <a href="mailto:a.moqadammehr@mrl-spl.ir">Aref Moqadam</a> - MRL-SPL Member
+ */
+
+#include "../../Modules/Perception/GoalFlightRecorder.h"
+#include <cstdio>
+#include <vector>
+
+static const char* stageNames[GoalFlightRecorder::numOfStages] =
+{
+  "scanning", "rejecting", "positioning", "validating", "posting"
+};
+
+static const char* counterNames[GoalPerfCounters::numOfCounters] =
+{
+  "cycles", "instructions", "cacheMisses", "branchMisses"
+};
+
+/**
+ * Print a histogram with fixed bucket width as text bars.
+ */
+static void printHistogram(const char* name, const std::vector<unsigned>& values, unsigned bucketWidth, const char* unit)
+{
+  if(values.empty())
+    return;
+
+  unsigned maxValue = 0;
+  unsigned long long sum = 0;
+  for(unsigned v : values)
+  {
+    maxValue = v > maxValue ? v : maxValue;
+    sum += v;
+  }
+
+  std::vector<unsigned> buckets(maxValue / bucketWidth + 1, 0);
+  for(unsigned v : values)
+    ++buckets[v / bucketWidth];
+
+  unsigned highest = 0;
+  for(unsigned b : buckets)
+    highest = b > highest ? b : highest;
+
+  std::printf("\n%s (mean %.1f %s, max %u %s)\n", name, (double)sum / values.size(), unit, maxValue, unit);
+  for(size_t i = 0; i < buckets.size(); ++i)
+  {
+    if(!buckets[i])
+      continue;
+    std::printf("%6u - %6u %s | %7u ", (unsigned)(i * bucketWidth), (unsigned)((i + 1) * bucketWidth - 1), unit, buckets[i]);
+    for(unsigned j = 0, bar = buckets[i] * 50 / highest; j < bar; ++j)
+      std::putchar('#');
+    std::putchar('\n');
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 2)
+  {
+    std::fprintf(stderr, "usage: %s <goalFlightRecorder.log> [timeline.csv]\n", argv[0]);
+    return 1;
+  }
+
+  std::FILE* in = std::fopen(argv[1], "rb");
+  if(!in)
+  {
+    std::fprintf(stderr, "cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  unsigned header[4];
+  if(std::fread(header, sizeof(header), 1, in) != 1 || header[0] != GoalFlightRecorder::magic ||
+     header[1] != GoalFlightRecorder::version || header[2] != sizeof(GoalFlightRecorder::Record))
+  {
+    std::fprintf(stderr, "%s is not a flight recorder dump of this version\n", argv[1]);
+    std::fclose(in);
+    return 1;
+  }
+
+  std::vector<GoalFlightRecorder::Record> records(header[3]);
+  const size_t read = records.empty() ? 0 : std::fread(&records[0], sizeof(GoalFlightRecorder::Record), records.size(), in);
+  records.resize(read);
+
+  //-- The counters of the same frames, if they were recorded
+  std::vector<GoalFlightRecorder::Counters> counters;
+  unsigned counterHeader[2];
+  if(std::fread(counterHeader, sizeof(counterHeader), 1, in) == 1 && counterHeader[0] &&
+     counterHeader[1] == sizeof(GoalFlightRecorder::Counters))
+  {
+    counters.resize(records.size());
+    if(counters.empty() || std::fread(&counters[0], sizeof(GoalFlightRecorder::Counters), counters.size(), in) != counters.size())
+      counters.clear();
+  }
+  std::fclose(in);
+
+  //-- Timeline, if requested
+  std::FILE* out = argc > 2 ? std::fopen(argv[2], "w") : nullptr;
+  if(argc > 2 && !out)
+  {
+    std::fprintf(stderr, "cannot open %s\n", argv[2]);
+    return 1;
+  }
+  if(out)
+  {
+    std::fprintf(out, "time,camera,flags,spotsFound,spotsVoted,spotsValidated,spotsRemaining,validity1,validity2");
+    for(int s = 0; s < GoalFlightRecorder::numOfStages; ++s)
+      std::fprintf(out, ",%s", stageNames[s]);
+    std::fprintf(out, ",total");
+    for(int s = 0; s < GoalFlightRecorder::numOfStages && !counters.empty(); ++s)
+      for(int c = 0; c < GoalPerfCounters::numOfCounters; ++c)
+        std::fprintf(out, ",%s.%s", stageNames[s], counterNames[c]);
+    std::fprintf(out, "\n");
+  }
+
+  std::vector<unsigned> durations[GoalFlightRecorder::numOfStages], totals, found, remaining;
+  unsigned long long counterSums[GoalFlightRecorder::numOfStages][GoalPerfCounters::numOfCounters] = {};
+  unsigned long long pathTotals[2] = {}; // generic and fixed resolution scans
+  unsigned pathFrames[2] = {};
+  unsigned long long partnerTotal = 0; // frames that scanned the field boundary twice
+  unsigned partnerFrames = 0;
+  for(size_t i = 0; i < records.size(); ++i)
+  {
+    const GoalFlightRecorder::Record& r = records[i];
+    unsigned total = 0;
+    for(int s = 0; s < GoalFlightRecorder::numOfStages; ++s)
+      total += r.durations[s];
+
+    if(out)
+    {
+      std::fprintf(out, "%u,%s,%u,%u,%u,%u,%u,%u,%u", r.time, r.camera ? "lower" : "upper", r.flags,
+                   r.spotsFound, r.spotsVoted, r.spotsValidated, r.spotsRemaining, r.validities[0], r.validities[1]);
+      for(int s = 0; s < GoalFlightRecorder::numOfStages; ++s)
+        std::fprintf(out, ",%u", r.durations[s]);
+      std::fprintf(out, ",%u", total);
+      for(int s = 0; s < GoalFlightRecorder::numOfStages && !counters.empty(); ++s)
+        for(int c = 0; c < GoalPerfCounters::numOfCounters; ++c)
+          std::fprintf(out, ",%u", counters[i].values[s][c]);
+      std::fprintf(out, "\n");
+    }
+
+    //-- Dropped, predicted and reused frames are not part of the statistics
+    if(r.flags & (GoalFlightRecorder::noCameraMatrix | GoalFlightRecorder::predicted | GoalFlightRecorder::reused))
+      continue;
+    for(int s = 0; s < GoalFlightRecorder::numOfStages; ++s)
+    {
+      durations[s].push_back(r.durations[s]);
+      for(int c = 0; c < GoalPerfCounters::numOfCounters && !counters.empty(); ++c)
+        counterSums[s][c] += counters[i].values[s][c];
+    }
+    totals.push_back(total);
+    const int path = r.flags & GoalFlightRecorder::fixedResolution ? 1 : 0;
+    pathTotals[path] += total;
+    ++pathFrames[path];
+    if(r.flags & GoalFlightRecorder::partnerSearch)
+    {
+      partnerTotal += total;
+      ++partnerFrames;
+    }
+    found.push_back(r.spotsFound);
+    remaining.push_back(r.spotsRemaining);
+  }
+  if(out)
+    std::fclose(out);
+
+  //-- Histograms
+  std::printf("%u frames, %u scanned\n", (unsigned)records.size(), (unsigned)totals.size());
+  printHistogram("total", totals, 100, "us");
+  for(int s = 0; s < GoalFlightRecorder::numOfStages; ++s)
+    printHistogram(stageNames[s], durations[s], 50, "us");
+  printHistogram("candidates after scanFieldBoundarySpots", found, 1, "");
+  printHistogram("candidates after all rejections", remaining, 1, "");
+
+  //-- Scans compiled for the resolution against the generic ones
+  static const char* pathNames[2] = {"generic scans", "fixed resolution scans"};
+  std::printf("\n");
+  for(int p = 0; p < 2; ++p)
+    if(pathFrames[p])
+      std::printf("%s: %u frames, mean total %.1f us\n", pathNames[p], pathFrames[p], (double)pathTotals[p] / pathFrames[p]);
+  if(partnerFrames)
+    std::printf("partner searches (field boundary scanned twice): %u frames, mean total %.1f us\n", partnerFrames, (double)partnerTotal / partnerFrames);
+
+  //-- Means of the hardware counters per frame
+  if(counters.empty())
+    std::printf("\nno hardware counters recorded\n");
+  else if(!totals.empty())
+  {
+    std::printf("\n%-12s %12s %12s %6s %12s %12s\n", "stage", "cycles", "instructions", "IPC", "cacheMisses", "branchMisses");
+    for(int s = 0; s < GoalFlightRecorder::numOfStages; ++s)
+    {
+      const unsigned long long* sums = counterSums[s];
+      std::printf("%-12s %12.0f %12.0f %6.2f %12.1f %12.1f\n", stageNames[s],
+                  (double)sums[GoalPerfCounters::cycles] / totals.size(),
+                  (double)sums[GoalPerfCounters::instructions] / totals.size(),
+                  sums[GoalPerfCounters::cycles] ? (double)sums[GoalPerfCounters::instructions] / sums[GoalPerfCounters::cycles] : 0.,
+                  (double)sums[GoalPerfCounters::cacheMisses] / totals.size(),
+                  (double)sums[GoalPerfCounters::branchMisses] / totals.size());
+    }
+    std::printf("only the cognition thread is counted, the strips of the worker threads are missing\n");
+  }
+  return 0;
+}